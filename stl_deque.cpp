@@ -8,6 +8,14 @@
 #ifndef __SGI_STL_INTERNAL_DEQUE_H
 #define __SGI_STL_INTERNAL_DEQUE_H
 
+// deque迭代器的equal()/lexicographical_compare()使用其中的比较内核
+#include <stl_simd_compare.h>
+
+// 慢路径的计数和计时, 见<stl_instrument.h>; 没有打开时为空
+#ifndef __STL_PROBE
+#  define __STL_PROBE(probe)
+#endif
+
 // 特性:
 //   对于任何的非奇异(nonsingular)的迭代器i
 //     i.node是map array中的某元素的地址. i.node的内容是一个指向某个结点的头的指针
@@ -29,8 +37,10 @@
 //
 //   [map, map + map_size)是一个合法的非空区间
 //   [start.node, finish.node]是内含在[map, map + map_size)区间的合法区间
-//   一个在[map, map + map_size)区间内的指针指向一个分配过的node,
-//   当且仅当此指针在[start.node, finish.node]区间内
+//   [start.node, finish.node]区间内的指针都指向一个分配过的node;
+//   区间之外的指针要么为0, 要么指向reserve_front()/reserve_back()预留的
+//   备用node(已分配, 但不含任何元素), 备用node由deque拥有,
+//   push_*和insert会优先使用它们, shrink_to_fit()会把它们全部释放
 
 // 在前一个版本的deque中, node_size被设定为定植.
 // 然而在这个版本中, 用户可以自定义node_size的大小.
@@ -56,23 +66,67 @@ __STL_BEGIN_NAMESPACE
 // 如果n ==0, 就返回默认值表示buffer size,默认值计算方法如下
 //    如果sz(元素类型大小sizeof(type))小于512, 返回512 / sz
 //    否则返回1
+//
+// 如果定义了__STL_DEQUE_POW2_BUFFERS, 默认值会向下取整到2的幂,
+// 这样迭代器的跨缓冲区运算和deque::operator[]就只需要移位和掩码,
+// 代价是每个缓冲区最多少用一半的空间; 使用者自定义的n不受影响
 inline size_t __deque_buf_size(size_t n, size_t sz)
 {
-  return n != 0 ? n : (sz < 512 ? size_t(512 / sz) : size_t(1));
+  if (n != 0) return n;
+  size_t m = sz < 512 ? size_t(512 / sz) : size_t(1);
+#ifdef __STL_DEQUE_POW2_BUFFERS
+  size_t p = 1;
+  while (p * 2 <= m) p *= 2;
+  m = p;
+#endif /* __STL_DEQUE_POW2_BUFFERS */
+  return m;
 }
 
+// 编译期求不大于N的最大的2的幂, 以及N以2为底的对数
+template <size_t N>
+struct __deque_floor_pow2 {
+  enum { value = 2 * __deque_floor_pow2<N / 2>::value };
+};
+
+__STL_TEMPLATE_NULL struct __deque_floor_pow2<1> { enum { value = 1 }; };
+
+template <size_t N>
+struct __deque_log2 {
+  enum { value = 1 + __deque_log2<N / 2>::value };
+};
+
+__STL_TEMPLATE_NULL struct __deque_log2<1> { enum { value = 0 }; };
+
+// 在编译期得到和__deque_buf_size()相同的缓冲区大小,
+// 如果它恰好是2的幂(元素大小是2的幂, 或者定义了__STL_DEQUE_POW2_BUFFERS),
+// pow2为1, 下标可以拆成 (i >> shift, i & mask)
+template <size_t BufSiz, size_t Sz>
+struct __deque_buf_traits {
+  enum { raw = BufSiz != 0 ? BufSiz : (Sz < 512 ? 512 / Sz : 1) };
+#ifdef __STL_DEQUE_POW2_BUFFERS
+  enum { size = BufSiz != 0 ? raw : __deque_floor_pow2<raw>::value };
+#else
+  enum { size = raw };
+#endif /* __STL_DEQUE_POW2_BUFFERS */
+  enum { pow2 = (size & (size - 1)) == 0 };
+  enum { shift = __deque_log2<size>::value };
+  enum { mask = size - 1 };
+};
+
 // 注意这里未继承自std::iterator
 #ifndef __STL_NON_TYPE_TMPL_PARAM_BUG
 template <class T, class Ref, class Ptr, size_t BufSiz>
 struct __deque_iterator {
   typedef __deque_iterator<T, T&, T*, BufSiz>             iterator;
   typedef __deque_iterator<T, const T&, const T*, BufSiz> const_iterator;
+  typedef __deque_buf_traits<BufSiz, sizeof(T)>          buf_traits;
   static size_t buffer_size() {return __deque_buf_size(BufSiz, sizeof(T)); }
 #else /* __STL_NON_TYPE_TMPL_PARAM_BUG */
 template <class T, class Ref, class Ptr>
 struct __deque_iterator {
   typedef __deque_iterator<T, T&, T*>             iterator;
   typedef __deque_iterator<T, const T&, const T*> const_iterator;
+  typedef __deque_buf_traits<0, sizeof(T)>        buf_traits;
   static size_t buffer_size() {return __deque_buf_size(0, sizeof(T)); }
 #endif
 
@@ -107,9 +161,10 @@ struct __deque_iterator {
 
   // 判断两个迭代器间的距离
 
+  // 缓冲区大小是编译期常量, 为2的幂时乘法就是移位
   difference_type operator-(const self& x) const
   {
-    return difference_type(buffer_size()) * (node - x.node - 1) +
+    return difference_type(buf_traits::size) * (node - x.node - 1) +
       (cur - first) + (x.last - x.cur);
   }
 
@@ -159,6 +214,20 @@ struct __deque_iterator {
   self& operator+=(difference_type n)
   {
     difference_type offset = n + (cur - first);
+    if (buf_traits::pow2) {
+      // 缓冲区大小为2的幂: 用移位求结点偏移, 用掩码求缓冲区内偏移,
+      // 负数先取反再移位, 避免对负数右移
+      if (size_t(offset) <= size_t(buf_traits::mask))
+        cur += n;
+      else {
+        difference_type node_offset =
+          offset > 0 ? difference_type(size_t(offset) >> buf_traits::shift)
+                     : -difference_type(size_t(-offset - 1) >> buf_traits::shift) - 1;
+        set_node(node + node_offset);
+        cur = first + difference_type(size_t(offset) & size_t(buf_traits::mask));
+      }
+      return *this;
+    }
     if (offset >= 0 && offset < difference_type(buffer_size()))
       cur += n; //目标位置在同一缓冲区内
     else {  //目标位置不在同一缓冲区内
@@ -252,11 +321,309 @@ inline ptrdiff_t* distance_type(const __deque_iterator<T, Ref, Ptr>&) {
 // 其实剖析到这里就没有什么难的了, deque的运算符才是核心
 #endif /* __STL_CLASS_PARTIAL_SPECIALIZATION */
 
+#ifndef __STL_NON_TYPE_TMPL_PARAM_BUG
+#  define __STL_DEQUE_ITER_PARAMS class T, class Ref, class Ptr, size_t BufSiz
+#  define __STL_DEQUE_ITER __deque_iterator<T, Ref, Ptr, BufSiz>
+#  define __STL_DEQUE_MUTABLE_ITER __deque_iterator<T, T&, T*, BufSiz>
+#  define __STL_DEQUE_ITER2_PARAMS                                        \
+     class T, class Ref, class Ptr, class Ref2, class Ptr2, size_t BufSiz
+#  define __STL_DEQUE_ITER2 __deque_iterator<T, Ref2, Ptr2, BufSiz>
+#else /* __STL_NON_TYPE_TMPL_PARAM_BUG */
+#  define __STL_DEQUE_ITER_PARAMS class T, class Ref, class Ptr
+#  define __STL_DEQUE_ITER __deque_iterator<T, Ref, Ptr>
+#  define __STL_DEQUE_MUTABLE_ITER __deque_iterator<T, T&, T*>
+#  define __STL_DEQUE_ITER2_PARAMS                                        \
+     class T, class Ref, class Ptr, class Ref2, class Ptr2
+#  define __STL_DEQUE_ITER2 __deque_iterator<T, Ref2, Ptr2>
+#endif /* __STL_NON_TYPE_TMPL_PARAM_BUG */
+
+// deque迭代器之间的copy()和copy_backward()
+// 通用版本每复制一个元素都要经过迭代器的越界判断;
+// 这里按源和目的两边的缓冲区边界分段, 每段交给指针版本的copy(),
+// 元素的赋值是平凡的(见<type_traits.h>)时每段就是一次memmove
+// erase(), insert和operator=中移动元素都会用到
+// 区间重叠时的要求和通用版本相同
+template <__STL_DEQUE_ITER_PARAMS>
+__STL_DEQUE_MUTABLE_ITER copy(__STL_DEQUE_ITER first, __STL_DEQUE_ITER last,
+                              __STL_DEQUE_MUTABLE_ITER result)
+{
+  typedef typename __STL_DEQUE_ITER::difference_type difference_type;
+  difference_type n = last - first;
+  while (n > 0) {
+    difference_type len = first.last - first.cur;
+    if (len > result.last - result.cur)
+      len = result.last - result.cur;
+    if (len > n)
+      len = n;
+    copy((const T*) first.cur, (const T*) first.cur + len, result.cur);
+    first += len;
+    result += len;
+    n -= len;
+  }
+  return result;
+}
+
+// 从后往前: last或result正好在缓冲区开头时, 这一段在前一个缓冲区的末尾
+template <__STL_DEQUE_ITER_PARAMS>
+__STL_DEQUE_MUTABLE_ITER copy_backward(__STL_DEQUE_ITER first,
+                                       __STL_DEQUE_ITER last,
+                                       __STL_DEQUE_MUTABLE_ITER result)
+{
+  typedef typename __STL_DEQUE_ITER::difference_type difference_type;
+  const difference_type buf_size = difference_type(last.buffer_size());
+  difference_type n = last - first;
+  while (n > 0) {
+    difference_type llen = last.cur - last.first;
+    T* lend = last.cur;
+    if (llen == 0) {
+      llen = buf_size;
+      lend = *(last.node - 1) + buf_size;
+    }
+    difference_type rlen = result.cur - result.first;
+    T* rend = result.cur;
+    if (rlen == 0) {
+      rlen = buf_size;
+      rend = *(result.node - 1) + buf_size;
+    }
+    difference_type len = llen < rlen ? llen : rlen;
+    if (len > n)
+      len = n;
+    copy_backward((const T*) lend - len, (const T*) lend, rend);
+    last -= len;
+    result -= len;
+    n -= len;
+  }
+  return result;
+}
+
+// deque迭代器之间的equal()和lexicographical_compare()
+// 元素是<stl_simd_compare.h>中有向量比较内核的算术类型时(__simd_comparable),
+// 按两边的缓冲区边界分段, 每段用__simd_mismatch()找第一个不相等的元素;
+// 其他类型逐个元素比较, 和通用的算法一样: equal()只用operator==,
+// lexicographical_compare()只用operator<
+// deque的operator==和operator<都由它们实现
+template <__STL_DEQUE_ITER2_PARAMS>
+bool __deque_equal(__STL_DEQUE_ITER first1, __STL_DEQUE_ITER last1,
+                   __STL_DEQUE_ITER2 first2, __true_type)
+{
+  typedef typename __STL_DEQUE_ITER::difference_type difference_type;
+  difference_type n = last1 - first1;
+  while (n > 0) {
+    difference_type len = first1.last - first1.cur;
+    if (len > first2.last - first2.cur)
+      len = first2.last - first2.cur;
+    if (len > n)
+      len = n;
+    if (__simd_mismatch((const T*) first1.cur, (const T*) first2.cur,
+                        size_t(len)) != size_t(len))
+      return false;
+    first1 += len;
+    first2 += len;
+    n -= len;
+  }
+  return true;
+}
+
+template <__STL_DEQUE_ITER2_PARAMS>
+bool __deque_equal(__STL_DEQUE_ITER first1, __STL_DEQUE_ITER last1,
+                   __STL_DEQUE_ITER2 first2, __false_type)
+{
+  for ( ; first1 != last1; ++first1, ++first2)
+    if (!(*first1 == *first2))
+      return false;
+  return true;
+}
+
+template <__STL_DEQUE_ITER2_PARAMS>
+inline bool equal(__STL_DEQUE_ITER first1, __STL_DEQUE_ITER last1,
+                  __STL_DEQUE_ITER2 first2)
+{
+  typedef typename __simd_comparable<T>::type comparable;
+  return __deque_equal(first1, last1, first2, comparable());
+}
+
+// 段内第一个不相等的位置上, 既不是a < b也不是b < a时(比如NaN)
+// 两个元素仍然等价, 要从下一个位置接着找
+template <__STL_DEQUE_ITER2_PARAMS>
+bool __deque_lexicographical_compare(__STL_DEQUE_ITER first1,
+                                     __STL_DEQUE_ITER last1,
+                                     __STL_DEQUE_ITER2 first2,
+                                     __STL_DEQUE_ITER2 last2, __true_type)
+{
+  typedef typename __STL_DEQUE_ITER::difference_type difference_type;
+  difference_type n1 = last1 - first1;
+  difference_type n2 = last2 - first2;
+  difference_type n = n1 < n2 ? n1 : n2;
+  while (n > 0) {
+    difference_type len = first1.last - first1.cur;
+    if (len > first2.last - first2.cur)
+      len = first2.last - first2.cur;
+    if (len > n)
+      len = n;
+    const T* a = first1.cur;
+    const T* b = first2.cur;
+    size_t i = 0;
+    while ((i += __simd_mismatch(a + i, b + i, size_t(len) - i)) < size_t(len)) {
+      if (a[i] < b[i])
+        return true;
+      if (b[i] < a[i])
+        return false;
+      ++i;
+    }
+    first1 += len;
+    first2 += len;
+    n -= len;
+  }
+  return n1 < n2;
+}
+
+template <__STL_DEQUE_ITER2_PARAMS>
+bool __deque_lexicographical_compare(__STL_DEQUE_ITER first1,
+                                     __STL_DEQUE_ITER last1,
+                                     __STL_DEQUE_ITER2 first2,
+                                     __STL_DEQUE_ITER2 last2, __false_type)
+{
+  for ( ; first1 != last1 && first2 != last2; ++first1, ++first2) {
+    if (*first1 < *first2)
+      return true;
+    if (*first2 < *first1)
+      return false;
+  }
+  return first1 == last1 && first2 != last2;
+}
+
+template <__STL_DEQUE_ITER2_PARAMS>
+inline bool lexicographical_compare(__STL_DEQUE_ITER first1,
+                                    __STL_DEQUE_ITER last1,
+                                    __STL_DEQUE_ITER2 first2,
+                                    __STL_DEQUE_ITER2 last2)
+{
+  typedef typename __simd_comparable<T>::type comparable;
+  return __deque_lexicographical_compare(first1, last1, first2, last2,
+                                         comparable());
+}
+
+#undef __STL_DEQUE_ITER_PARAMS
+#undef __STL_DEQUE_ITER
+#undef __STL_DEQUE_MUTABLE_ITER
+#undef __STL_DEQUE_ITER2_PARAMS
+#undef __STL_DEQUE_ITER2
+
+// 把[first, first + n)构造到从dest开始的deque未初始化空间中
+// 每个缓冲区调用一次uninitialized_copy, 不再逐个元素经过迭代器的边界判断,
+// 源是指针且元素是POD时, 每个缓冲区就是一次memmove
+// 调用者保证[dest, dest + n)所需的缓冲区都已分配
+// 注: commit or rollback, 抛出异常时已经构造的元素会被析构
+template <class ForwardIterator, class Size, class Iterator>
+void __uninitialized_copy_n_to_deque(ForwardIterator first, Size n,
+                                     Iterator dest)
+{
+  Iterator cur = dest;
+  __STL_TRY {
+    while (n > 0) {
+      Size chunk = cur.last - cur.cur;
+      if (chunk > n)
+        chunk = n;
+      ForwardIterator mid = first;
+      advance(mid, chunk);
+      uninitialized_copy(first, mid, cur.cur);
+      first = mid;
+      n -= chunk;
+      if (n > 0) {
+        cur.set_node(cur.node + 1);
+        cur.cur = cur.first;
+      }
+    }
+  }
+  __STL_UNWIND(destroy(dest, cur));
+}
+
+#ifdef __STL_DEQUE_STATS
+// 定义了__STL_DEQUE_STATS时, 每个deque记录自己的map和缓冲区分配次数,
+// 以及map和缓冲区占用的字节数和峰值; 没有定义时deque中不含这个成员,
+// 分配路径上也没有任何额外代码
+struct __deque_alloc_counters {
+  size_t map_allocations;       // 分配map的次数, 包括构造时的第一次
+  size_t map_reallocations;     // reallocate_map()的次数, 包括原地移动
+  size_t nodes_allocated;       // 分配缓冲区的次数
+  size_t nodes_deallocated;     // 释放缓冲区的次数
+  size_t bytes_resident;        // 当前map和缓冲区占用的字节数
+  size_t peak_bytes;            // bytes_resident的最大值
+
+  __deque_alloc_counters()
+    : map_allocations(0), map_reallocations(0), nodes_allocated(0),
+      nodes_deallocated(0), bytes_resident(0), peak_bytes(0) {}
+
+  void allocated(size_t bytes)
+  {
+    bytes_resident += bytes;
+    if (bytes_resident > peak_bytes)
+      peak_bytes = bytes_resident;
+  }
+  void deallocated(size_t bytes) { bytes_resident -= bytes; }
+};
+#endif /* __STL_DEQUE_STATS */
+
+// deque的缓冲区和map从哪里来: 默认直接向Alloc申请, owner(即deque对象)不使用,
+// 内联之后和直接调用simple_alloc一样
+// small_deque用自己的分配器类型特化这个类, 优先使用对象内嵌的存储,
+// 见<stl_small_deque.h>; 普通deque没有任何额外的成员和判断
+template <class T, class Alloc>
+struct __deque_buffer_source
+{
+  // deque内部的临时deque使用的分配器, 临时对象不在small_deque中, 不能用内嵌存储
+  typedef Alloc plain_alloc;
+
+  static T* allocate_node(const void*, size_t n)
+  {
+    return simple_alloc<T, Alloc>::allocate(n);
+  }
+  static void deallocate_node(const void*, T* p, size_t n)
+  {
+    simple_alloc<T, Alloc>::deallocate(p, n);
+  }
+  static T** allocate_map(const void*, size_t n)
+  {
+    return simple_alloc<T*, Alloc>::allocate(n);
+  }
+  static void deallocate_map(const void*, T** p, size_t n)
+  {
+    simple_alloc<T*, Alloc>::deallocate(p, n);
+  }
+};
+
+// deque::memory_stats()的返回值, 反映调用时deque的内存布局
+// 空位(slack)以元素个数计, 字节数只算map和缓冲区, 不含deque对象本身
+struct deque_memory_stats {
+  size_t map_size;              // map的槽位数
+  size_t map_bytes;
+  size_t map_front_free;        // start.node之前没有缓冲区的槽位数
+  size_t map_back_free;         // finish.node之后没有缓冲区的槽位数
+  size_t buffer_size;           // 每个缓冲区容纳的元素个数
+  size_t buffer_bytes;
+  size_t nodes;                 // [start.node, finish.node]中的缓冲区个数
+  size_t spare_nodes;           // 备用缓冲区个数, 见reserve_back()
+  size_t front_slack;           // 第一个缓冲区中start.cur之前的空位
+  size_t back_slack;            // 最后一个缓冲区中finish.cur及其之后的空位
+  size_t bytes_used;            // size() * sizeof(value_type)
+  size_t bytes_resident;        // map_bytes + 所有缓冲区的字节数
+  size_t inline_bytes;          // 其中位于small_deque对象内部的字节数,
+                                // 由small_deque::memory_stats()填写
+#ifdef __STL_DEQUE_STATS
+  __deque_alloc_counters counters;
+#endif /* __STL_DEQUE_STATS */
+};
+
+// 按缓冲区批量读写文件, 见<stl_deque_io.h>
+template <class T, class Alloc, size_t BufSiz> struct __deque_io;
+
 // See __deque_buf_size().  The only reason that the default value is 0
 //  is as a workaround for bugs in the way that some compilers handle
 //  constant expressions.
 template <class T, class Alloc = alloc, size_t BufSiz = 0>
 class deque {
+  friend struct __deque_io<T, Alloc, BufSiz>;
+
 public:                         // Basic types
   typedef T value_type;
   typedef value_type* pointer;
@@ -270,7 +637,7 @@ public:                         // Iterators
 #ifndef __STL_NON_TYPE_TMPL_PARAM_BUG
   typedef __deque_iterator<T, T&, T*, BufSiz>              iterator;
 
-  typedef __deque_iterator<T, const T&, const T&, BufSiz>  const_iterator;
+  typedef __deque_iterator<T, const T&, const T*, BufSiz>  const_iterator;
 #else /* __STL_NON_TYPE_TMPL_PARAM_BUG */
   typedef __deque_iterator<T, T&, T*>                      iterator;
   typedef __deque_iterator<T, const T&, const T*>          const_iterator;
@@ -294,6 +661,7 @@ protected:                      // Internal typedefs
   // 这个提供STL标准的allocator接口, 见<stl_alloc.h>
   typedef simple_alloc<value_type, Alloc> data_allocator;
   typedef simple_alloc<pointer, Alloc> map_allocator;
+  typedef __deque_buffer_source<value_type, Alloc> buffer_source;
 
   // 获取缓冲区最大存储元素数量
   static size_type buffer_size()
@@ -312,6 +680,10 @@ protected:                      // Data members
   map_pointer map;
   size_type map_size;   // map容量,有多少个指针
 
+#ifdef __STL_DEQUE_STATS
+  __deque_alloc_counters counters;  // 分配统计, 见memory_stats()
+#endif /* __STL_DEQUE_STATS */
+
 public:                         // Basic accessors
   iterator begin() { return start; }
   iterator end() { return finish; }
@@ -329,8 +701,22 @@ public:                         // Basic accessors
 
   // 提供随机访问能力, 其调用的是迭代器重载的operator []
   // 其实际地址需要进行一些列的计算, 效率有损失
-  reference operator[](size_type n) { return start[difference_type(n)]; }
+  // 缓冲区大小为2的幂时, 直接以start所在缓冲区的头为原点拆分下标,
+  // 不构造临时迭代器, 也没有分支
+  reference operator[](size_type n) {
+    if (iterator::buf_traits::pow2) {
+      size_type i = n + size_type(start.cur - start.first);
+      return start.node[i >> iterator::buf_traits::shift]
+                       [i & iterator::buf_traits::mask];
+    }
+    return start[difference_type(n)];
+  }
   const_reference operator[](size_type n) const {
+    if (iterator::buf_traits::pow2) {
+      size_type i = n + size_type(start.cur - start.first);
+      return start.node[i >> iterator::buf_traits::shift]
+                       [i & iterator::buf_traits::mask];
+    }
     return start[difference_type(n)];
   }
 
@@ -368,7 +754,7 @@ public:                         // Constructor, destructor.
   {
     create_map_and_nodes(x.size());
     __STL_TRY {
-      uninitialized_copy(x.begin(), x.end(), start);  // <stl_uninitialized.h>
+      __uninitialized_copy_n_to_deque(x.begin(), x.size(), start);
     }
     __STL_UNWIND(destroy_map_and_nodes());
   }
@@ -413,7 +799,7 @@ public:                         // Constructor, destructor.
   {
     create_map_and_nodes(last - first);
     __STL_TRY {
-      uninitialized_copy(first, last, start);
+      __uninitialized_copy_n_to_deque(first, last - first, start);
     }
     __STL_UNWIND(destroy_map_and_nodes());
   }
@@ -423,7 +809,7 @@ public:                         // Constructor, destructor.
   {
     create_map_and_nodes(last - first);
     __STL_TRY {
-      uninitialized_copy(first, last, start);
+      __uninitialized_copy_n_to_deque(first, last - first, start);
     }
     __STL_UNWIND(destroy_map_and_nodes());
   }
@@ -461,6 +847,9 @@ public:                         // Constructor, destructor.
     __STD::swap(finish, x.finish);
     __STD::swap(map, x.map);
     __STD::swap(map_size, x.map_size);
+#ifdef __STL_DEQUE_STATS
+    __STD::swap(counters, x.counters);  // 统计跟着内存走
+#endif /* __STL_DEQUE_STATS */
   }
 
 public:                         // push_* and pop_*
@@ -510,6 +899,68 @@ public:                         // push_* and pop_*
       pop_front_aux();
   }
 
+  // 批量弹出头部的min(n, size())个元素
+  // 逐个缓冲区处理: 整段复制到out/交给f, 再整段析构, 用空的缓冲区一次释放
+  // 注: 复制或f抛出异常时, 当前这段元素仍留在deque中
+#ifdef __STL_MEMBER_TEMPLATES
+
+  template <class OutputIterator>
+  OutputIterator pop_front_n(size_type n, OutputIterator out)
+  {
+    if (n == 1 && start.cur != finish.cur) {  // 单个元素不值得走copy()
+      *out = *start.cur;
+      ++out;
+      pop_front();
+      return out;
+    }
+    while (n > 0) {
+      size_type len = front_segment_size(n);
+      if (len == 0)         // deque已空
+        break;
+      out = copy(start.cur, start.cur + len, out);
+      destroy_front_segment(len);
+      n -= len;
+    }
+    return out;
+  }
+
+  // 对每段连续的元素调用f(first, last), first和last为value_type*
+  template <class Function>
+  Function consume_front(size_type n, Function f)
+  {
+    while (n > 0) {
+      size_type len = front_segment_size(n);
+      if (len == 0)         // deque已空
+        break;
+      f(start.cur, start.cur + len);
+      destroy_front_segment(len);
+      n -= len;
+    }
+    return f;
+  }
+
+#else /* __STL_MEMBER_TEMPLATES */
+
+  value_type* pop_front_n(size_type n, value_type* out)
+  {
+    if (n == 1 && start.cur != finish.cur) {
+      *out++ = *start.cur;
+      pop_front();
+      return out;
+    }
+    while (n > 0) {
+      size_type len = front_segment_size(n);
+      if (len == 0)         // deque已空
+        break;
+      out = copy(start.cur, start.cur + len, out);
+      destroy_front_segment(len);
+      n -= len;
+    }
+    return out;
+  }
+
+#endif /* __STL_MEMBER_TEMPLATES */
+
 public:                         // Insert
 
 /////////////////////////
@@ -576,6 +1027,104 @@ public:                         // Insert
 
   void resize(size_type new_size) { resize(new_size, value_type()); }
 
+  // 批量追加到尾部/头部, 保持[first, last)原来的顺序
+  // 前向迭代器先一次分配好全部缓冲区, 再逐个缓冲区构造, 见insert()
+  // 注: commit or rollback
+#ifdef __STL_MEMBER_TEMPLATES
+
+  template <class InputIterator>
+  void append(InputIterator first, InputIterator last)
+  {
+    insert(finish, first, last, iterator_category(first));
+  }
+
+  template <class InputIterator>
+  void prepend(InputIterator first, InputIterator last)
+  {
+    prepend(first, last, iterator_category(first));
+  }
+
+#else /* __STL_MEMBER_TEMPLATES */
+
+  void append(const value_type* first, const value_type* last)
+  {
+    insert(finish, first, last);
+  }
+  void append(const_iterator first, const_iterator last)
+  {
+    insert(finish, first, last);
+  }
+  void prepend(const value_type* first, const value_type* last)
+  {
+    insert(start, first, last);
+  }
+  void prepend(const_iterator first, const_iterator last)
+  {
+    insert(start, first, last);
+  }
+
+#endif /* __STL_MEMBER_TEMPLATES */
+
+  // 尾部缓冲区放得下时(至少留一个空位, 同push_back)直接构造, 小批量不走insert()
+  void append_n(const value_type* first, size_type n)
+  {
+    if (n < size_type(finish.last - finish.cur)) {
+      uninitialized_copy(first, first + n, finish.cur);
+      finish.cur += n;
+    }
+    else
+      append(first, first + n);
+  }
+  void prepend_n(const value_type* first, size_type n)
+  {
+    prepend(first, first + n);
+  }
+
+public:                         // Capacity
+
+  // 预留空间, 使得之后尾部的元素个数增加n个(push_back()或在尾部insert)
+  // 都不再分配map和缓冲区; reserve_front()对应头部
+  // 预留的缓冲区作为备用node挂在map中; 弹出元素时, 如果外侧还有备用node,
+  // 腾出的缓冲区也会留作备用, 所以中途的pop不会让预留的空间失效
+  // 为此即使当前缓冲区已经够用, 也至少预留一个备用node
+  void reserve_back(size_type n)
+  {
+    size_type vacancies = (finish.last - finish.cur) - 1;
+    if (n > 0)
+      new_elements_at_back(n > vacancies ? n - vacancies : 1);
+  }
+
+  void reserve_front(size_type n)
+  {
+    size_type vacancies = start.cur - start.first;
+    if (n > 0)
+      new_elements_at_front(n > vacancies ? n - vacancies : 1);
+  }
+
+  // 释放所有备用node, 并把map缩小到create_map_and_nodes()会分配的大小
+  void shrink_to_fit();
+
+  // 当前的内存使用情况, 需要遍历一遍map, 复杂度O(map_size)
+  // 定义了__STL_DEQUE_STATS时还包括分配计数, 见__deque_alloc_counters
+  deque_memory_stats memory_stats() const;
+
+public:                         // Raw copy
+
+  // 以下两个函数只适用于POD类型, 元素按字节复制
+  // serialize()把所有元素依次复制到buf, 每个缓冲区一次memcpy,
+  // buf至少要有size() * sizeof(value_type)字节, 返回写入的字节数
+  size_type serialize(void* buf) const;
+
+  // 用buf中的n个元素替换deque的内容: 一次分配好map和所需的缓冲区,
+  // 再逐个缓冲区复制, 见__uninitialized_copy_n_to_deque()
+  // 注: commit or rollback
+  void deserialize(const void* buf, size_type n)
+  {
+    const value_type* first = (const value_type*) buf;
+    deque tmp(first, first + n);
+    swap(tmp);
+  }
+
 public:                         // Erase
 
   iterator erase(iterator pos)
@@ -632,6 +1181,27 @@ protected:                        // Internal push_* and pop_*
   void pop_back_aux();
   void pop_front_aux();
 
+  // 第一个缓冲区中最多能连续弹出的元素个数, 不超过n
+  size_type front_segment_size(size_type n) const
+  {
+    size_type len = (start.node == finish.node ? finish.cur : start.last)
+                    - start.cur;
+    return len < n ? len : n;
+  }
+
+  // 析构头部的len个元素(都在第一个缓冲区中), 缓冲区空了就释放
+  // 缓冲区用完时后面一定还有缓冲区, 理由见pop_front_aux()
+  void destroy_front_segment(size_type len)
+  {
+    destroy(start.cur, start.cur + len);
+    start.cur += len;
+    if (start.cur == start.last) {
+      release_node(start.node, spare_before(start.node));
+      start.set_node(start.node + 1);
+      start.cur = start.first;
+    }
+  }
+
 protected:                        // Internal insert functions
 
 #ifdef __STL_MEMBER_TEMPLATES
@@ -644,6 +1214,22 @@ protected:                        // Internal insert functions
   void insert(iterator pos, ForwardIterator first, ForwardIterator last,
               forward_iterator_tag);
 
+  // 输入迭代器只能遍历一次, 先追加到临时deque中再整体放到头部,
+  // 避免逐个插入时每次都要移动已经插入的元素
+  template <class InputIterator>
+  void prepend(InputIterator first, InputIterator last, input_iterator_tag)
+  {
+    deque<T, typename buffer_source::plain_alloc, BufSiz> tmp(first, last);
+    insert(start, tmp.begin(), tmp.end(), forward_iterator_tag());
+  }
+
+  template <class ForwardIterator>
+  void prepend(ForwardIterator first, ForwardIterator last,
+               forward_iterator_tag)
+  {
+    insert(start, first, last, forward_iterator_tag());
+  }
+
 #endif /* __STL_MEMBER_TEMPLATES */
 
   iterator insert_aux(iterator pos, const value_type& x);
@@ -710,12 +1296,60 @@ protected:                      // Allocation of map and nodes
   void reallocate_map(size_type nodes_to_add, bool add_at_front);
 
   // 分配内存, 不进行构造
-  pointer allocate_node() { return data_allocator::allocate(buffer_size()); }
+  // 缓冲区和map都经过__deque_buffer_source, small_deque在那里使用内嵌的存储
+  pointer allocate_node()
+  {
+    pointer n = buffer_source::allocate_node(this, buffer_size());
+#ifdef __STL_DEQUE_STATS
+    ++counters.nodes_allocated;
+    counters.allocated(buffer_size() * sizeof(value_type));
+#endif /* __STL_DEQUE_STATS */
+    return n;
+  }
 
   // 释放内存, 不进行析构
   void deallocate_node(pointer n)
   {
-    data_allocator::deallocate(n, buffer_size());
+    buffer_source::deallocate_node(this, n, buffer_size());
+#ifdef __STL_DEQUE_STATS
+    ++counters.nodes_deallocated;
+    counters.deallocated(buffer_size() * sizeof(value_type));
+#endif /* __STL_DEQUE_STATS */
+  }
+
+  // map的分配和释放都经过这里, 以便统计
+  map_pointer allocate_map(size_type n)
+  {
+    map_pointer m = buffer_source::allocate_map(this, n);
+#ifdef __STL_DEQUE_STATS
+    ++counters.map_allocations;
+    counters.allocated(n * sizeof(pointer));
+#endif /* __STL_DEQUE_STATS */
+    return m;
+  }
+
+  void deallocate_map(map_pointer m, size_type n)
+  {
+    buffer_source::deallocate_map(this, m, n);
+#ifdef __STL_DEQUE_STATS
+    counters.deallocated(n * sizeof(pointer));
+#endif /* __STL_DEQUE_STATS */
+  }
+
+  // 释放n所指的缓冲区并清零槽位; keep为真时不释放, 留作备用节点
+  void release_node(map_pointer n, bool keep)
+  {
+    if (!keep) {
+      deallocate_node(*n);
+      *n = 0;
+    }
+  }
+
+  // n外侧相邻的槽位上是否有备用节点
+  bool spare_before(map_pointer n) const { return n != map && *(n - 1) != 0; }
+  bool spare_after(map_pointer n) const
+  {
+    return n + 1 != map + map_size && *(n + 1) != 0;
   }
 
 #ifdef __STL_NON_TYPE_TMPL_PARAM_BUG
@@ -764,7 +1398,7 @@ void deque<T, Alloc, BufSize>::insert(iterator pos,
   if (pos.cur == start.cur) {
     iterator new_start = reserve_elements_at_front(n);
     __STL_TRY {
-      uninitialized_copy(first, last, new_start);
+      __uninitialized_copy_n_to_deque(first, n, new_start);
       start = new_start;
     }
     __STL_UNWIND(destroy_nodes_at_front(new_start));
@@ -772,7 +1406,7 @@ void deque<T, Alloc, BufSize>::insert(iterator pos,
   else if (pos.cur == finish.cur) {
     iterator new_finish = reserve_elements_at_back(n);
     __STL_TRY {
-      uninitialized_copy(first, last, finish);
+      __uninitialized_copy_n_to_deque(first, n, finish);
       finish = new_finish;
     }
     __STL_UNWIND(destroy_nodes_at_back(new_finish));
@@ -790,7 +1424,7 @@ void deque<T, Alloc, BufSize>::insert(iterator pos,
   if (pos.cur == start.cur) {
     iterator new_start = reserve_elements_at_front(n);
     __STL_TRY {
-      uninitialized_copy(first, last, new_start);
+      __uninitialized_copy_n_to_deque(first, n, new_start);
       start = new_start;
     }
     __STL_UNWIND(destroy_nodes_at_front(new_start));
@@ -798,7 +1432,7 @@ void deque<T, Alloc, BufSize>::insert(iterator pos,
   else if (pos.cur == finish.cur) {
     iterator new_finish = reserve_elements_at_back(n);
     __STL_TRY {
-      uninitialized_copy(first, last, finish);
+      __uninitialized_copy_n_to_deque(first, n, finish);
       finish = new_finish;
     }
     __STL_UNWIND(destroy_nodes_at_back(new_finish));
@@ -813,7 +1447,7 @@ void deque<T, Alloc, BufSize>::insert(iterator pos,
 // 擦除[first, last)区间的元素
 //////////////////////////////
 template <class T, class Alloc, size_t BufSize>
-deque<T, Alloc, BufSize>::iterator
+typename deque<T, Alloc, BufSize>::iterator
 deque<T, Alloc, BufSize>::erase(iterator first, iterator last)
 {
 	//清楚的是整个deque，直接调用clear()
@@ -831,16 +1465,18 @@ deque<T, Alloc, BufSize>::erase(iterator first, iterator last)
       iterator new_start = start + n;  //标记deque新起点
       destroy(start, new_start); //移动完毕，将冗余元素析构
 	  //将冗余缓冲区释放
+      bool keep = spare_before(start.node);
       for (map_pointer cur = start.node; cur < new_start.node; ++cur)
-        data_allocator::deallocate(*cur, buffer_size());
+        release_node(cur, keep);
       start = new_start;  //设定deque新起点
     }
     else { //清除区间后方元素少，向前移动后方元素（覆盖清除区）
       copy(last, finish, first);
       iterator new_finish = finish - n;
       destroy(new_finish, finish);
+      bool keep = spare_after(finish.node);
       for (map_pointer cur = new_finish.node + 1; cur <= finish.node; ++cur)
-        data_allocator::deallocate(*cur, buffer_size());
+        release_node(cur, keep);
       finish = new_finish;
     }
     return start + elems_before;
@@ -852,12 +1488,15 @@ deque<T, Alloc, BufSize>::erase(iterator first, iterator last)
 template <class T, class Alloc, size_t BufSize>
 void deque<T, Alloc, BufSize>::clear()
 {
+  // 尾部外侧有备用节点时, 腾出的缓冲区也留作备用
+  bool keep = spare_after(finish.node);
+
   // 以下针对头尾以外的每个缓冲区（它们是饱满的）
   for (map_pointer node = start.node + 1; node < finish.node; ++node) {
     //将缓冲区内所有元素析构 
 	destroy(*node, *node + buffer_size());
 	//释放缓冲区内存
-    data_allocator::deallocate(*node, buffer_size());
+    release_node(node, keep);
   }
 
   // 至少有头尾两个缓冲区
@@ -865,7 +1504,7 @@ void deque<T, Alloc, BufSize>::clear()
     destroy(start.cur, start.last); //将头缓冲区目前的元素析构
     destroy(finish.first, finish.cur); //将尾缓冲区目前元素析构
 	//!!!注意：以下释放尾缓冲区，头缓冲区保留
-    data_allocator::deallocate(finish.first, buffer_size());
+    release_node(finish.node, keep);
   }
   // 析构所有元素, 但是不释放空间, 因为deque要满足这个前置条件
   // 具体的细节见本文件开头'特性'
@@ -885,7 +1524,8 @@ void deque<T, Alloc, BufSize>::create_map_and_nodes(size_type num_elements)
   //最大为“所需节点数加2”，前后各预备一个，扩充时可用
   map_size = max(initial_map_size(), num_nodes + 2);
   //配置有map_size个节点的map
-  map = map_allocator::allocate(map_size);
+  map = allocate_map(map_size);
+  fill(map, map + map_size, pointer(0)); //没有节点的槽位为0
 
   // 将[nstart, nfinish)区间设置在map的中间,
   // 这样就能保证前后增长而尽可能减少map的重新分配次数
@@ -904,7 +1544,7 @@ void deque<T, Alloc, BufSize>::create_map_and_nodes(size_type num_elements)
   catch(...) {
     for (map_pointer n = nstart; n < cur; ++n)
       deallocate_node(*n);
-    map_allocator::deallocate(map, map_size);
+    deallocate_map(map, map_size);
     throw;
   }
 #     endif /* __STL_USE_EXCEPTIONS */
@@ -917,12 +1557,14 @@ void deque<T, Alloc, BufSize>::create_map_and_nodes(size_type num_elements)
 }
 
 // This is only used as a cleanup function in catch clauses.
+// 备用节点也在这里释放
 template <class T, class Alloc, size_t BufSize>
 void deque<T, Alloc, BufSize>::destroy_map_and_nodes()
 {
-  for (map_pointer cur = start.node; cur <= finish.node; ++cur)
-    deallocate_node(*cur);
-  map_allocator::deallocate(map, map_size);
+  for (map_pointer cur = map; cur < map + map_size; ++cur)
+    if (*cur)
+      deallocate_node(*cur);
+  deallocate_map(map, map_size);
 }
 
 /*
@@ -975,7 +1617,7 @@ void deque<T, Alloc, BufSize>::range_initialize(ForwardIterator first,
   distance(first, last, n);
   create_map_and_nodes(n);
   __STL_TRY {
-    uninitialized_copy(first, last, start);
+    __uninitialized_copy_n_to_deque(first, n, start);
   }
   __STL_UNWIND(destroy_map_and_nodes());
 }
@@ -988,24 +1630,28 @@ void deque<T, Alloc, BufSize>::range_initialize(ForwardIterator first,
 template <class T, class Alloc, size_t BufSize>
 void deque<T, Alloc, BufSize>::push_back_aux(const value_type& t)
 {
+  __STL_PROBE(deque_push_back_aux);
   value_type t_copy = t;
   reserve_map_at_back(); //若符合某种条件则必须重换一个map
-  *(finish.node + 1) = allocate_node(); //配置一个新节点（缓冲区）
+  if (*(finish.node + 1) == 0)  //没有备用节点
+    *(finish.node + 1) = allocate_node(); //配置一个新节点（缓冲区）
   __STL_TRY {
     construct(finish.cur, t_copy);
     finish.set_node(finish.node + 1); //改变finish，令其指向新缓冲区
     finish.cur = finish.first; //设定finish的状态
   }
-  __STL_UNWIND(deallocate_node(*(finish.node + 1)));
+  __STL_UNWIND(release_node(finish.node + 1, spare_after(finish.node + 1)));
 }
 
 // Called only if start.cur == start.first.
 template <class T, class Alloc, size_t BufSize>
 void deque<T, Alloc, BufSize>::push_front_aux(const value_type& t)
 {
+  __STL_PROBE(deque_push_front_aux);
   value_type t_copy = t;
-  reserve_map_at_front();
-  *(start.node - 1) = allocate_node(); //若符合某条件则必须重换一个map
+  reserve_map_at_front(); //若符合某条件则必须重换一个map
+  if (*(start.node - 1) == 0)  //没有备用节点
+    *(start.node - 1) = allocate_node();
   __STL_TRY {
     start.set_node(start.node - 1); //配置一个新缓冲区
     start.cur = start.last - 1;
@@ -1015,7 +1661,7 @@ void deque<T, Alloc, BufSize>::push_front_aux(const value_type& t)
   catch(...) {  //commit or rollback：若非全部成功，就一个不留
     start.set_node(start.node + 1);
     start.cur = start.first;
-    deallocate_node(*(start.node - 1));
+    release_node(start.node - 1, spare_before(start.node - 1));
     throw;
   }
 #     endif /* __STL_USE_EXCEPTIONS */
@@ -1025,7 +1671,8 @@ void deque<T, Alloc, BufSize>::push_front_aux(const value_type& t)
 template <class T, class Alloc, size_t BufSize>
 void deque<T, Alloc, BufSize>:: pop_back_aux()
 {
-  deallocate_node(finish.first); //释放最后一个缓冲区
+  __STL_PROBE(deque_pop_back_aux);
+  release_node(finish.node, spare_after(finish.node)); //释放最后一个缓冲区
   finish.set_node(finish.node - 1);//调整finish的状态，指向
   finish.cur = finish.last - 1;    //上一个缓冲区的最后一个元素
   destroy(finish.cur);
@@ -1039,8 +1686,9 @@ void deque<T, Alloc, BufSize>:: pop_back_aux()
 template <class T, class Alloc, size_t BufSize>
 void deque<T, Alloc, BufSize>::pop_front_aux()
 {
+  __STL_PROBE(deque_pop_front_aux);
   destroy(start.cur);
-  deallocate_node(start.first);
+  release_node(start.node, spare_before(start.node));
   start.set_node(start.node + 1);
   start.cur = start.first;
 }
@@ -1072,7 +1720,7 @@ void deque<T, Alloc, BufSize>::insert(iterator pos,
   if (pos.cur == start.cur) {
     iterator new_start = reserve_elements_at_front(n);
     __STL_TRY {
-      uninitialized_copy(first, last, new_start);
+      __uninitialized_copy_n_to_deque(first, n, new_start);
       start = new_start;
     }
     __STL_UNWIND(destroy_nodes_at_front(new_start));
@@ -1080,7 +1728,7 @@ void deque<T, Alloc, BufSize>::insert(iterator pos,
   else if (pos.cur == finish.cur) {
     iterator new_finish = reserve_elements_at_back(n);
     __STL_TRY {
-      uninitialized_copy(first, last, finish);
+      __uninitialized_copy_n_to_deque(first, n, finish);
       finish = new_finish;
     }
     __STL_UNWIND(destroy_nodes_at_back(new_finish));
@@ -1124,3 +1772,203 @@ deque<T, Alloc, BufSize>::insert_aux(iterator pos, const value_type& x)
   *pos = x_copy; //在插入点上设定新值
   return pos;
 }
+
+// 在头部之前准备好能容纳new_elements个元素的缓冲区, 已有的备用节点直接使用
+// 分配失败时, 已经分配的缓冲区留作备用节点, deque本身不变
+template <class T, class Alloc, size_t BufSize>
+void deque<T, Alloc, BufSize>::new_elements_at_front(size_type new_elements)
+{
+  size_type new_nodes = (new_elements + buffer_size() - 1) / buffer_size();
+  reserve_map_at_front(new_nodes);
+  for (size_type i = 1; i <= new_nodes; ++i)
+    if (*(start.node - i) == 0)
+      *(start.node - i) = allocate_node();
+}
+
+template <class T, class Alloc, size_t BufSize>
+void deque<T, Alloc, BufSize>::new_elements_at_back(size_type new_elements)
+{
+  size_type new_nodes = (new_elements + buffer_size() - 1) / buffer_size();
+  reserve_map_at_back(new_nodes);
+  for (size_type i = 1; i <= new_nodes; ++i)
+    if (*(finish.node + i) == 0)
+      *(finish.node + i) = allocate_node();
+}
+
+// 插入失败时释放new_elements_at_*()准备的缓冲区
+template <class T, class Alloc, size_t BufSize>
+void deque<T, Alloc, BufSize>::destroy_nodes_at_front(iterator before_start)
+{
+  bool keep = spare_before(before_start.node);
+  for (map_pointer n = before_start.node; n < start.node; ++n)
+    release_node(n, keep);
+}
+
+template <class T, class Alloc, size_t BufSize>
+void deque<T, Alloc, BufSize>::destroy_nodes_at_back(iterator after_finish)
+{
+  bool keep = spare_after(after_finish.node);
+  for (map_pointer n = after_finish.node; n > finish.node; --n)
+    release_node(n, keep);
+}
+
+// 重新安排map, 使add_at_front指定的一侧至少有nodes_to_add个空闲槽位
+// 备用节点随着使用中的节点一起搬移: [lo, hi]是所有非空槽位所在的范围,
+// 整体放在map的中间; 如果map足够大就在原地移动, 否则换一个更大的map
+template <class T, class Alloc, size_t BufSize>
+void deque<T, Alloc, BufSize>::reallocate_map(size_type nodes_to_add,
+                                              bool add_at_front)
+{
+  __STL_PROBE(deque_reallocate_map);
+#ifdef __STL_DEQUE_STATS
+  ++counters.map_reallocations;
+#endif /* __STL_DEQUE_STATS */
+
+  map_pointer lo = map;
+  while (*lo == 0)
+    ++lo;
+  map_pointer hi = map + map_size - 1;
+  while (*hi == 0)
+    --hi;
+
+  size_type old_num_nodes = hi - lo + 1;
+  size_type new_num_nodes = old_num_nodes + nodes_to_add;
+  difference_type start_offset = start.node - lo;
+  difference_type finish_offset = finish.node - lo;
+
+  map_pointer new_lo;
+  if (map_size > 2 * new_num_nodes) {
+    new_lo = map + (map_size - new_num_nodes) / 2
+                 + (add_at_front ? nodes_to_add : 0);
+    if (new_lo < lo) {
+      copy(lo, hi + 1, new_lo);
+      fill(new_lo + old_num_nodes, hi + 1, pointer(0));
+    }
+    else {
+      copy_backward(lo, hi + 1, new_lo + old_num_nodes);
+      fill(lo, new_lo < hi + 1 ? new_lo : hi + 1, pointer(0));
+    }
+  }
+  else {
+    size_type new_map_size = map_size + max(map_size, nodes_to_add) + 2;
+
+    map_pointer new_map = allocate_map(new_map_size);
+    fill(new_map, new_map + new_map_size, pointer(0));
+    new_lo = new_map + (new_map_size - new_num_nodes) / 2
+                     + (add_at_front ? nodes_to_add : 0);
+    copy(lo, hi + 1, new_lo);
+    deallocate_map(map, map_size);
+
+    map = new_map;
+    map_size = new_map_size;
+  }
+
+  start.set_node(new_lo + start_offset);
+  finish.set_node(new_lo + finish_offset);
+}
+
+template <class T, class Alloc, size_t BufSize>
+void deque<T, Alloc, BufSize>::shrink_to_fit()
+{
+  map_pointer map_end = map + map_size;
+  for (map_pointer n = map; n < start.node; ++n)
+    release_node(n, *n == 0);
+  for (map_pointer n = finish.node + 1; n < map_end; ++n)
+    release_node(n, *n == 0);
+
+  size_type num_nodes = finish.node - start.node + 1;
+  size_type new_map_size = max(initial_map_size(), num_nodes + 2);
+  if (new_map_size < map_size) {
+    map_pointer new_map = allocate_map(new_map_size);
+    fill(new_map, new_map + new_map_size, pointer(0));
+    map_pointer new_start = new_map + (new_map_size - num_nodes) / 2;
+    copy(start.node, finish.node + 1, new_start);
+    deallocate_map(map, map_size);
+
+    map = new_map;
+    map_size = new_map_size;
+    start.set_node(new_start);
+    finish.set_node(new_start + num_nodes - 1);
+  }
+}
+
+template <class T, class Alloc, size_t BufSize>
+typename deque<T, Alloc, BufSize>::size_type
+deque<T, Alloc, BufSize>::serialize(void* buf) const
+{
+  char* out = (char*) buf;
+  for (map_pointer node = start.node; node <= finish.node; ++node) {
+    pointer first = node == start.node ? start.cur : *node;
+    pointer last = node == finish.node ? finish.cur : *node + buffer_size();
+    size_type bytes = (last - first) * sizeof(value_type);
+    memcpy(out, first, bytes);
+    out += bytes;
+  }
+  return out - (char*) buf;
+}
+
+template <class T, class Alloc, size_t BufSize>
+deque_memory_stats deque<T, Alloc, BufSize>::memory_stats() const
+{
+  deque_memory_stats s;
+  s.map_size = map_size;
+  s.map_bytes = map_size * sizeof(pointer);
+  s.buffer_size = buffer_size();
+  s.buffer_bytes = buffer_size() * sizeof(value_type);
+  s.nodes = finish.node - start.node + 1;
+  s.front_slack = start.cur - start.first;
+  s.back_slack = finish.last - finish.cur;
+  s.bytes_used = size() * sizeof(value_type);
+
+  // map两端: 备用缓冲区之外的空槽位才是可供增长的空闲槽位
+  s.spare_nodes = 0;
+  s.map_front_free = 0;
+  s.map_back_free = 0;
+  for (map_pointer n = map; n < start.node; ++n)
+    if (*n)
+      ++s.spare_nodes;
+    else
+      ++s.map_front_free;
+  for (map_pointer n = finish.node + 1; n < map + map_size; ++n)
+    if (*n)
+      ++s.spare_nodes;
+    else
+      ++s.map_back_free;
+
+  s.bytes_resident = s.map_bytes + (s.nodes + s.spare_nodes) * s.buffer_bytes;
+  s.inline_bytes = 0;
+#ifdef __STL_DEQUE_STATS
+  s.counters = counters;
+#endif /* __STL_DEQUE_STATS */
+  return s;
+}
+
+#ifndef __STL_NON_TYPE_TMPL_PARAM_BUG
+
+template <class T, class Alloc, size_t BufSiz>
+bool operator==(const deque<T, Alloc, BufSiz>& x,
+                const deque<T, Alloc, BufSiz>& y)
+{
+  return x.size() == y.size() && equal(x.begin(), x.end(), y.begin());
+}
+
+template <class T, class Alloc, size_t BufSiz>
+bool operator<(const deque<T, Alloc, BufSiz>& x,
+               const deque<T, Alloc, BufSiz>& y)
+{
+  return lexicographical_compare(x.begin(), x.end(), y.begin(), y.end());
+}
+
+#endif /* __STL_NON_TYPE_TMPL_PARAM_BUG */
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma reset woff 1174
+#endif
+
+__STL_END_NAMESPACE
+
+#endif /* __SGI_STL_INTERNAL_DEQUE_H */
+
+// Local Variables:
+// mode:C++
+// End:
@@ -0,0 +1,359 @@
+// Filename:    stl_deque_algo.h
+// 利用deque分段结构的算法: 排序和二分查找
+//
+// deque的元素存放在一个个定长的缓冲区(下面称为段)中, 段内是连续的,
+// 通用算法通过__deque_iterator访问每个元素, 每次跳跃都要判断是否越过缓冲区;
+// 这里的算法先在段内直接用指针处理, 再在段之间做少量的合并或查找:
+//   deque_sort / deque_stable_sort   先对每个段排序, 再两两归并,
+//                                    需要一块和区间等长的临时缓冲区
+//   lower_bound / upper_bound        先在map上二分找到所在的段, 再在段内二分,
+//                                    比通用版本更特化, 对deque迭代器会自动选中
+// 使用前需要先包含<stl_deque.h>和<stl_algo.h>
+
+#ifndef __SGI_STL_INTERNAL_DEQUE_ALGO_H
+#define __SGI_STL_INTERNAL_DEQUE_ALGO_H
+
+__STL_BEGIN_NAMESPACE
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma set woff 1174
+#endif
+
+#ifndef __STL_NON_TYPE_TMPL_PARAM_BUG
+#  define __STL_DEQUE_ITER_PARAMS class T, class Ref, class Ptr, size_t BufSiz
+#  define __STL_DEQUE_ITER __deque_iterator<T, Ref, Ptr, BufSiz>
+#else /* __STL_NON_TYPE_TMPL_PARAM_BUG */
+#  define __STL_DEQUE_ITER_PARAMS class T, class Ref, class Ptr
+#  define __STL_DEQUE_ITER __deque_iterator<T, Ref, Ptr>
+#endif /* __STL_NON_TYPE_TMPL_PARAM_BUG */
+
+// 把[first, last)按缓冲区切分
+// 第i段是first.node + i所指的缓冲区中落在[first, last)内的部分,
+// 第0段从first.cur开始, 最后一段到last.cur结束(可能为空)
+// split()再把段按顺序分成若干批, 供并行算法分配任务
+template <class Iterator>
+struct __deque_segments
+{
+  typedef typename Iterator::value_type value_type;
+  typedef typename Iterator::map_pointer map_pointer;
+
+  Iterator first;
+  Iterator last;
+  size_t count;         // 段数
+  size_t grain;         // 每批的段数
+  size_t batches;       // 批数
+
+  __deque_segments(const Iterator& f, const Iterator& l)
+    : first(f), last(l), count(size_t(l.node - f.node) + 1),
+      grain(count), batches(1) {}
+
+  // 分成不超过n批, 每批的段数相同(最后一批可能较少)
+  void split(size_t n)
+  {
+    grain = (count + n - 1) / n;
+    batches = (count + grain - 1) / grain;
+  }
+
+  size_t batch_begin(size_t b) const { return b * grain; }
+  size_t batch_end(size_t b) const
+  {
+    size_t e = (b + 1) * grain;
+    return e < count ? e : count;
+  }
+
+  void segment(size_t i, value_type*& b, value_type*& e) const
+  {
+    map_pointer node = first.node + i;
+    b = i == 0 ? first.cur : *node;
+    e = node == last.node ? last.cur : *node + Iterator::buffer_size();
+  }
+
+  // 第i段的第一个元素在[first, last)中的序号
+  ptrdiff_t offset(size_t i) const
+  {
+    if (i == 0)
+      return 0;
+    return (first.last - first.cur) +
+      ptrdiff_t(i - 1) * ptrdiff_t(Iterator::buffer_size());
+  }
+};
+
+// 对第[b, e)段分别排序, 段内是连续内存, 直接用指针版本的sort
+template <class Iterator, class Compare>
+void __deque_sort_segments(const __deque_segments<Iterator>& seg,
+                           size_t b, size_t e, Compare comp, bool stable)
+{
+  typedef typename Iterator::value_type value_type;
+  for (size_t i = b; i < e; ++i) {
+    value_type* p;
+    value_type* q;
+    seg.segment(i, p, q);
+    if (stable)
+      stable_sort(p, q, comp);
+    else
+      sort(p, q, comp);
+  }
+}
+
+// 一轮归并中的第[jb, je)对:
+// 把src中第2j和第2j + 1个有序段合并到dst中的相同位置,
+// 落单的最后一段原样复制; bounds[i]是第i段的起始序号, bounds[nruns]为总长度
+template <class Source, class Dest, class Compare>
+void __deque_merge_runs(Source src, Dest dst, const ptrdiff_t* bounds,
+                        size_t nruns, size_t jb, size_t je, Compare comp)
+{
+  for (size_t j = jb; j < je; ++j) {
+    size_t l = 2 * j;
+    size_t m = l + 1;
+    if (m >= nruns)
+      copy(src + bounds[l], src + bounds[nruns], dst + bounds[l]);
+    else {
+      size_t r = m + 1 < nruns ? m + 1 : nruns;
+      merge(src + bounds[l], src + bounds[m], src + bounds[m],
+            src + bounds[r], dst + bounds[l], comp);
+    }
+  }
+}
+
+// 归并之后有序段数减半, 新的第j段从原来的第2j段开始
+inline size_t __deque_merge_bounds(ptrdiff_t* bounds, size_t nruns)
+{
+  size_t n = (nruns + 1) / 2;
+  for (size_t j = 1; j < n; ++j)
+    bounds[j] = bounds[2 * j];
+  bounds[n] = bounds[nruns];
+  return n;
+}
+
+// 段内排序和每轮归并由Runner决定如何执行,
+// 这里是顺序执行的版本, <stl_deque_parallel.h>提供多线程的版本,
+// 两者都通过参数类型重载选择
+struct __deque_serial_runner {};
+
+template <class Iterator, class Compare>
+inline void __deque_run_sort(__deque_serial_runner,
+                             const __deque_segments<Iterator>& seg,
+                             Compare comp, bool stable)
+{
+  __deque_sort_segments(seg, 0, seg.count, comp, stable);
+}
+
+template <class Source, class Dest, class Compare>
+inline void __deque_run_merge(__deque_serial_runner, Source src, Dest dst,
+                              const ptrdiff_t* bounds, size_t nruns,
+                              Compare comp)
+{
+  __deque_merge_runs(src, dst, bounds, nruns, 0, (nruns + 1) / 2, comp);
+}
+
+// 归并在deque与临时缓冲区之间来回进行, 每轮只搬运一次数据;
+// 最后结果如果在临时缓冲区中, 再复制回deque
+template <class Iterator, class Compare, class Runner>
+void __deque_segment_sort(Iterator first, Iterator last, Compare comp,
+                          bool stable, Runner run)
+{
+  typedef typename Iterator::value_type value_type;
+  typedef simple_alloc<value_type, alloc> buffer_allocator;
+  typedef simple_alloc<ptrdiff_t, alloc> bounds_allocator;
+
+  ptrdiff_t len = last - first;
+  if (len < 2)
+    return;
+
+  __deque_segments<Iterator> seg(first, last);
+  __deque_run_sort(run, seg, comp, stable);
+  if (seg.count == 1)
+    return;
+
+  size_t nruns = seg.count;
+  ptrdiff_t* bounds = bounds_allocator::allocate(nruns + 1);
+  for (size_t i = 0; i < nruns; ++i)
+    bounds[i] = seg.offset(i);
+  bounds[nruns] = len;
+
+  value_type* buf = 0;
+  __STL_TRY {
+    buf = buffer_allocator::allocate(len);
+    __STL_TRY {
+      uninitialized_copy(first, last, buf);
+    }
+    __STL_UNWIND(buffer_allocator::deallocate(buf, len));
+  }
+  __STL_UNWIND(bounds_allocator::deallocate(bounds, seg.count + 1));
+
+  __STL_TRY {
+    bool in_buffer = false;
+    while (nruns > 1) {
+      if (in_buffer)
+        __deque_run_merge(run, buf, first, bounds, nruns, comp);
+      else
+        __deque_run_merge(run, first, buf, bounds, nruns, comp);
+      nruns = __deque_merge_bounds(bounds, nruns);
+      in_buffer = !in_buffer;
+    }
+    if (in_buffer)
+      copy(buf, buf + len, first);
+  }
+  __STL_UNWIND((destroy(buf, buf + len),
+                buffer_allocator::deallocate(buf, len),
+                bounds_allocator::deallocate(bounds, seg.count + 1)));
+
+  destroy(buf, buf + len);
+  buffer_allocator::deallocate(buf, len);
+  bounds_allocator::deallocate(bounds, seg.count + 1);
+}
+
+template <__STL_DEQUE_ITER_PARAMS>
+inline void deque_sort(__STL_DEQUE_ITER first, __STL_DEQUE_ITER last)
+{
+  __deque_segment_sort(first, last, less<T>(), false,
+                       __deque_serial_runner());
+}
+
+template <__STL_DEQUE_ITER_PARAMS, class Compare>
+inline void deque_sort(__STL_DEQUE_ITER first, __STL_DEQUE_ITER last,
+                       Compare comp)
+{
+  __deque_segment_sort(first, last, comp, false,
+                       __deque_serial_runner());
+}
+
+// 段内用stable_sort, 段间的merge在相等时取前一段的元素, 所以整体是稳定的
+template <__STL_DEQUE_ITER_PARAMS>
+inline void deque_stable_sort(__STL_DEQUE_ITER first, __STL_DEQUE_ITER last)
+{
+  __deque_segment_sort(first, last, less<T>(), true,
+                       __deque_serial_runner());
+}
+
+template <__STL_DEQUE_ITER_PARAMS, class Compare>
+inline void deque_stable_sort(__STL_DEQUE_ITER first, __STL_DEQUE_ITER last,
+                              Compare comp)
+{
+  __deque_segment_sort(first, last, comp, true,
+                       __deque_serial_runner());
+}
+
+// 有序区间[first, last)中, before(x)为真的元素都排在为假的元素之前,
+// 返回第一个before(x)为假的位置
+// 先在map上二分: 找到最后一个首元素满足before的段(没有则为第一段),
+// 答案只可能在这一段内, 或者是下一段的开头
+template <class Iterator, class Before>
+Iterator __deque_partition_point(Iterator first, Iterator last,
+                                 Before before)
+{
+  typedef typename Iterator::value_type value_type;
+  typedef typename Iterator::map_pointer map_pointer;
+
+  if (first == last)
+    return last;
+
+  // 只有首元素落在区间内的段才参与二分
+  map_pointer lo = first.node;
+  map_pointer hi = last.cur == last.first ? last.node - 1 : last.node;
+  while (lo < hi) {
+    map_pointer mid = lo + (hi - lo + 1) / 2;
+    if (before(**mid))
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+
+  value_type* b = lo == first.node ? first.cur : *lo;
+  value_type* e = lo == last.node ? last.cur : *lo + Iterator::buffer_size();
+  ptrdiff_t len = e - b;
+  while (len > 0) {
+    ptrdiff_t half = len >> 1;
+    if (before(b[half])) {
+      b += half + 1;
+      len -= half + 1;
+    }
+    else
+      len = half;
+  }
+
+  Iterator result = first;
+  if (b == e) {
+    if (lo == last.node)
+      return last;
+    result.set_node(lo + 1);
+    result.cur = result.first;
+  }
+  else {
+    result.set_node(lo);
+    result.cur = b;
+  }
+  return result;
+}
+
+template <class E, class V, class Compare>
+struct __deque_lower_bound_pred
+{
+  const V* value;
+  Compare comp;
+  __deque_lower_bound_pred(const V& v, Compare c) : value(&v), comp(c) {}
+  bool operator()(const E& x) { return comp(x, *value); }
+};
+
+template <class E, class V, class Compare>
+struct __deque_upper_bound_pred
+{
+  const V* value;
+  Compare comp;
+  __deque_upper_bound_pred(const V& v, Compare c) : value(&v), comp(c) {}
+  bool operator()(const E& x) { return !comp(*value, x); }
+};
+
+// 默认比较用operator<, 和通用版本一样不要求元素类型与查找的值类型相同
+template <class A, class B>
+struct __deque_less
+{
+  bool operator()(const A& a, const B& b) const { return a < b; }
+};
+
+template <__STL_DEQUE_ITER_PARAMS, class V>
+inline __STL_DEQUE_ITER lower_bound(__STL_DEQUE_ITER first,
+                                    __STL_DEQUE_ITER last, const V& value)
+{
+  return __deque_partition_point(first, last,
+    __deque_lower_bound_pred<T, V, __deque_less<T, V> >(value,
+                                                    __deque_less<T, V>()));
+}
+
+template <__STL_DEQUE_ITER_PARAMS, class V, class Compare>
+inline __STL_DEQUE_ITER lower_bound(__STL_DEQUE_ITER first,
+                                    __STL_DEQUE_ITER last, const V& value,
+                                    Compare comp)
+{
+  return __deque_partition_point(first, last,
+    __deque_lower_bound_pred<T, V, Compare>(value, comp));
+}
+
+template <__STL_DEQUE_ITER_PARAMS, class V>
+inline __STL_DEQUE_ITER upper_bound(__STL_DEQUE_ITER first,
+                                    __STL_DEQUE_ITER last, const V& value)
+{
+  return __deque_partition_point(first, last,
+    __deque_upper_bound_pred<T, V, __deque_less<V, T> >(value,
+                                                    __deque_less<V, T>()));
+}
+
+template <__STL_DEQUE_ITER_PARAMS, class V, class Compare>
+inline __STL_DEQUE_ITER upper_bound(__STL_DEQUE_ITER first,
+                                    __STL_DEQUE_ITER last, const V& value,
+                                    Compare comp)
+{
+  return __deque_partition_point(first, last,
+    __deque_upper_bound_pred<T, V, Compare>(value, comp));
+}
+
+#undef __STL_DEQUE_ITER_PARAMS
+#undef __STL_DEQUE_ITER
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma reset woff 1174
+#endif
+
+__STL_END_NAMESPACE
+
+#endif /* __SGI_STL_INTERNAL_DEQUE_ALGO_H */
@@ -0,0 +1,189 @@
+// Filename:    stl_deque_io.h
+// 按缓冲区批量读写deque, 只适用于POD类型
+//
+// deque的每个缓冲区都是连续的内存, 所以不必逐个元素读写:
+//   deque_write()  把[begin(), end())按缓冲区组成iovec, 用writev()写出
+//   deque_read()   先一次准备好n个元素需要的缓冲区, 再用readv()直接读入,
+//                  成功后才替换原来的内容
+// 两者都有small_deque的版本, 要先包含<stl_small_deque.h>;
+// small_deque的内嵌存储不能交给临时对象, 所以直接读到它自己的备用缓冲区中
+// 文件中只有元素的字节, 不含元素个数, 调用者需要自己记录
+// 失败时返回false, errno由writev()/readv()设置; 文件提前结束时errno不变
+// 内存中的复制见deque::serialize()/deserialize()
+// 需要POSIX的readv/writev, 使用前需要先包含<stl_deque.h>
+
+#ifndef __SGI_STL_INTERNAL_DEQUE_IO_H
+#define __SGI_STL_INTERNAL_DEQUE_IO_H
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <limits.h>
+#include <errno.h>
+
+__STL_BEGIN_NAMESPACE
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma set woff 1174
+#endif
+
+#ifdef IOV_MAX
+static const int __deque_iov_max = IOV_MAX;
+#else
+static const int __deque_iov_max = 16;
+#endif
+
+// 反复调用writev()/readv()直到iov中的数据全部传完, 会修改iov
+inline bool __deque_transfer(int fd, struct iovec* iov, int cnt, bool writing)
+{
+  while (cnt > 0) {
+    ssize_t r = writing ? writev(fd, iov, cnt) : readv(fd, iov, cnt);
+    if (r < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    if (r == 0 && !writing)     // 文件提前结束
+      return false;
+
+    size_t done = size_t(r);
+    while (cnt > 0 && done >= iov->iov_len) {
+      done -= iov->iov_len;
+      ++iov;
+      --cnt;
+    }
+    if (cnt > 0) {
+      iov->iov_base = (char*) iov->iov_base + done;
+      iov->iov_len -= done;
+    }
+  }
+  return true;
+}
+
+// deque的友元, 需要直接操作finish
+template <class T, class Alloc, size_t BufSiz>
+struct __deque_io
+{
+  typedef deque<T, Alloc, BufSiz> deque_type;
+  typedef typename deque_type::const_iterator const_iterator;
+  typedef typename deque_type::size_type size_type;
+
+  // 把从first开始的n个元素按缓冲区分成若干iovec, 每凑满一批就传输一次
+  // 只用到迭代器中的缓冲区指针, 读入时传入的是指向可写缓冲区的位置
+  static bool transfer(int fd, const_iterator first, size_type n, bool writing)
+  {
+    struct iovec iov[__deque_iov_max];
+    int cnt = 0;
+    while (n > 0) {
+      size_type len = first.last - first.cur;
+      if (len > n)
+        len = n;
+      iov[cnt].iov_base = first.cur;
+      iov[cnt].iov_len = len * sizeof(T);
+      ++cnt;
+      n -= len;
+      if (n > 0)
+        first += len;
+      if (cnt == __deque_iov_max || n == 0) {
+        if (!__deque_transfer(fd, iov, cnt, writing))
+          return false;
+        cnt = 0;
+      }
+    }
+    return true;
+  }
+
+  static bool write(int fd, const deque_type& d)
+  {
+    return transfer(fd, d.begin(), d.size(), true);
+  }
+
+  // reserve_back()之后[finish, finish + n)的缓冲区都已分配,
+  // 直接读到那里, 全部读完才移动finish; 失败时那些缓冲区留作备用, 随tmp释放
+  static bool read(int fd, deque_type& d, size_type n)
+  {
+    deque_type tmp;
+    tmp.reserve_back(n);
+    if (!transfer(fd, tmp.finish, n, false))
+      return false;
+    tmp.finish += n;
+    d.swap(tmp);
+    return true;
+  }
+
+  // 不经过临时deque: 在d的尾部预留缓冲区并读到那里, 成功后再擦除原来的元素
+  // 失败时d的元素不变, 预留的缓冲区留作备用
+  static bool read_in_place(int fd, deque_type& d, size_type n)
+  {
+    size_type len = d.size();
+    d.reserve_back(n);
+    if (!transfer(fd, d.finish, n, false))
+      return false;
+    d.finish += n;
+    d.erase(d.begin(), d.begin() + len);
+    return true;
+  }
+};
+
+template <class T, class Alloc, size_t BufSiz>
+inline bool deque_write(int fd, const deque<T, Alloc, BufSiz>& d)
+{
+  return __deque_io<T, Alloc, BufSiz>::write(fd, d);
+}
+
+// 从fd读入n个元素, 替换d原来的内容; 失败时d不变
+template <class T, class Alloc, size_t BufSiz>
+inline bool deque_read(int fd, deque<T, Alloc, BufSiz>& d, size_t n)
+{
+  return __deque_io<T, Alloc, BufSiz>::read(fd, d, n);
+}
+
+#if defined(__SGI_STL_INTERNAL_SMALL_DEQUE_H) \
+    && !defined(__STL_NON_TYPE_TMPL_PARAM_BUG) \
+    && defined(__STL_CLASS_PARTIAL_SPECIALIZATION)
+
+// small_deque的友元, 需要取得它私有继承的deque
+template <class T, size_t N, class Alloc>
+struct __small_deque_io
+{
+  typedef small_deque<T, N, Alloc> small_type;
+  typedef deque<T, __small_deque_alloc<T, N, Alloc>, N> deque_type;
+  typedef __deque_io<T, __small_deque_alloc<T, N, Alloc>, N> io;
+
+  static bool write(int fd, const small_type& d)
+  {
+    const deque_type& x = d;
+    return io::write(fd, x);
+  }
+
+  static bool read(int fd, small_type& d, size_t n)
+  {
+    deque_type& x = d;
+    return io::read_in_place(fd, x, n);
+  }
+};
+
+template <class T, size_t N, class Alloc>
+inline bool deque_write(int fd, const small_deque<T, N, Alloc>& d)
+{
+  return __small_deque_io<T, N, Alloc>::write(fd, d);
+}
+
+template <class T, size_t N, class Alloc>
+inline bool deque_read(int fd, small_deque<T, N, Alloc>& d, size_t n)
+{
+  return __small_deque_io<T, N, Alloc>::read(fd, d, n);
+}
+
+#endif /* __SGI_STL_INTERNAL_SMALL_DEQUE_H && ... */
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma reset woff 1174
+#endif
+
+__STL_END_NAMESPACE
+
+#endif /* __SGI_STL_INTERNAL_DEQUE_IO_H */
+
+// Local Variables:
+// mode:C++
+// End:
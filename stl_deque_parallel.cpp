@@ -0,0 +1,481 @@
+// Filename:    stl_deque_parallel.h
+// deque上的并行算法: for_each, transform, reduce, count_if, find_if, sort, stable_sort
+//
+// deque的map把元素天然分成了一个个缓冲区(下面称为段),
+// 这里的算法把[first, last)按段分成若干批, 工作线程从__parallel_batches
+// 中动态领取一批段, 在段内直接用指针遍历, 不经过__deque_iterator的边界判断
+// 注意:
+//   1. 只有在<stl_config.h>中定义了__STL_PTHREADS时才可用,
+//      需要先包含<stl_parallel.h>和<stl_deque_algo.h>
+//   2. 传入的函数对象被所有线程共享, 必须可以被并发调用, 而且不能抛出异常
+//   3. nthreads为0时使用在线的CPU个数, 元素很少时退化为调用者线程上的顺序执行
+//   4. 各个段的处理顺序是不确定的, reduce要求op满足结合律,
+//      但各段的部分结果仍然按顺序合并, 所以不要求交换律
+
+#ifndef __SGI_STL_INTERNAL_DEQUE_PARALLEL_H
+#define __SGI_STL_INTERNAL_DEQUE_PARALLEL_H
+
+#ifdef __STL_PTHREADS
+
+__STL_BEGIN_NAMESPACE
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma set woff 1174
+#endif
+
+#ifndef __STL_NON_TYPE_TMPL_PARAM_BUG
+#  define __STL_DEQUE_ITER_PARAMS class T, class Ref, class Ptr, size_t BufSiz
+#  define __STL_DEQUE_ITER __deque_iterator<T, Ref, Ptr, BufSiz>
+#else /* __STL_NON_TYPE_TMPL_PARAM_BUG */
+#  define __STL_DEQUE_ITER_PARAMS class T, class Ref, class Ptr
+#  define __STL_DEQUE_ITER __deque_iterator<T, Ref, Ptr>
+#endif /* __STL_NON_TYPE_TMPL_PARAM_BUG */
+
+// 元素少于这个数时不值得创建线程
+const size_t __deque_parallel_threshold = 32768;
+
+// 平均每个线程分到的批数, 批数越多负载越均衡, 但领取任务的加锁次数也越多
+const size_t __deque_parallel_batches_per_thread = 8;
+
+// 按线程数切分批次, 返回实际使用的线程数
+template <class Iterator>
+size_t __deque_parallel_split(__deque_segments<Iterator>& seg, size_t n,
+                              size_t nthreads)
+{
+  if (nthreads == 0)
+    nthreads = __parallel_default_threads();
+  seg.split(nthreads * __deque_parallel_batches_per_thread);
+  if (n < __deque_parallel_threshold)
+    nthreads = 1;
+  return nthreads < seg.batches ? nthreads : seg.batches;
+}
+
+template <class Iterator, class Function>
+struct __deque_for_each_worker
+{
+  typedef typename Iterator::value_type value_type;
+
+  const __deque_segments<Iterator>* seg;
+  __parallel_batches* work;
+  Function* f;
+
+  void operator()(size_t)
+  {
+    size_t b;
+    while (work->next(b)) {
+      for (size_t i = seg->batch_begin(b); i < seg->batch_end(b); ++i) {
+        value_type* p;
+        value_type* e;
+        seg->segment(i, p, e);
+        for ( ; p != e; ++p)
+          (*f)(*p);
+      }
+    }
+  }
+};
+
+template <class Iterator, class OutputIterator, class UnaryOperation>
+struct __deque_transform_worker
+{
+  typedef typename Iterator::value_type value_type;
+
+  const __deque_segments<Iterator>* seg;
+  __parallel_batches* work;
+  OutputIterator result;
+  UnaryOperation* op;
+
+  void operator()(size_t)
+  {
+    size_t b;
+    while (work->next(b)) {
+      for (size_t i = seg->batch_begin(b); i < seg->batch_end(b); ++i) {
+        value_type* p;
+        value_type* e;
+        seg->segment(i, p, e);
+        OutputIterator out = result + seg->offset(i);
+        for ( ; p != e; ++p, ++out)
+          *out = (*op)(*p);
+      }
+    }
+  }
+};
+
+// 每批得到一个部分结果, 由该批的第一个元素开始累积
+template <class Iterator, class U, class BinaryOperation>
+struct __deque_reduce_worker
+{
+  typedef typename Iterator::value_type value_type;
+
+  const __deque_segments<Iterator>* seg;
+  __parallel_batches* work;
+  BinaryOperation* op;
+  U* partial;           // 未初始化的存储, 每批一个
+  char* has_partial;    // 该批是否非空, 即partial[b]是否已构造
+
+  void operator()(size_t)
+  {
+    size_t b;
+    while (work->next(b)) {
+      bool any = false;
+      for (size_t i = seg->batch_begin(b); i < seg->batch_end(b); ++i) {
+        value_type* p;
+        value_type* e;
+        seg->segment(i, p, e);
+        if (p == e)
+          continue;
+        if (!any) {
+          construct(partial + b, U(*p));
+          any = true;
+          ++p;
+        }
+        for ( ; p != e; ++p)
+          partial[b] = (*op)(partial[b], *p);
+      }
+      has_partial[b] = any;
+    }
+  }
+};
+
+template <class Iterator, class Predicate>
+struct __deque_count_if_worker
+{
+  typedef typename Iterator::value_type value_type;
+
+  const __deque_segments<Iterator>* seg;
+  __parallel_batches* work;
+  Predicate* pred;
+  ptrdiff_t* counts;    // 每批一个计数, 不同线程写不同的位置, 无需加锁
+
+  void operator()(size_t)
+  {
+    size_t b;
+    while (work->next(b)) {
+      ptrdiff_t n = 0;
+      for (size_t i = seg->batch_begin(b); i < seg->batch_end(b); ++i) {
+        value_type* p;
+        value_type* e;
+        seg->segment(i, p, e);
+        for ( ; p != e; ++p)
+          if ((*pred)(*p))
+            ++n;
+      }
+      counts[b] = n;
+    }
+  }
+};
+
+// 某一批中找到匹配后, 编号更大的批次不再分出;
+// 正在处理的编号更小的批次会继续做完, 最后取编号最小的命中
+template <class Iterator, class Predicate>
+struct __deque_find_if_worker
+{
+  typedef typename Iterator::value_type value_type;
+
+  const __deque_segments<Iterator>* seg;
+  __parallel_batches* work;
+  Predicate* pred;
+  value_type** hit;     // 每批第一个命中的元素, 没有则为0
+  size_t* hit_segment;  // 命中元素所在的段
+
+  void operator()(size_t)
+  {
+    size_t b;
+    while (work->next(b)) {
+      for (size_t i = seg->batch_begin(b); i < seg->batch_end(b); ++i) {
+        value_type* p;
+        value_type* e;
+        seg->segment(i, p, e);
+        for ( ; p != e; ++p)
+          if ((*pred)(*p))
+            break;
+        if (p != e) {
+          hit[b] = p;
+          hit_segment[b] = i;
+          work->stop(b + 1);
+          break;
+        }
+      }
+    }
+  }
+};
+
+// 对[first, last)中的每个元素调用f
+// 与for_each不同, 不返回f, 因为f被多个线程共享, 其状态没有意义
+template <__STL_DEQUE_ITER_PARAMS, class Function>
+void parallel_for_each(__STL_DEQUE_ITER first, __STL_DEQUE_ITER last,
+                       Function f, size_t nthreads = 0)
+{
+  typedef __STL_DEQUE_ITER iterator;
+  if (first == last)
+    return;
+  __deque_segments<iterator> seg(first, last);
+  nthreads = __deque_parallel_split(seg, size_t(last - first), nthreads);
+  __parallel_batches work(seg.batches);
+  __deque_for_each_worker<iterator, Function> worker;
+  worker.seg = &seg;
+  worker.work = &work;
+  worker.f = &f;
+  __parallel_run(nthreads, worker);
+}
+
+// *(result + i) = op(*(first + i)), result必须是随机访问迭代器,
+// 而且[result, result + (last - first))不能与[first, last)部分重叠
+template <__STL_DEQUE_ITER_PARAMS, class OutputIterator, class UnaryOperation>
+OutputIterator parallel_transform(__STL_DEQUE_ITER first,
+                                  __STL_DEQUE_ITER last,
+                                  OutputIterator result, UnaryOperation op,
+                                  size_t nthreads = 0)
+{
+  typedef __STL_DEQUE_ITER iterator;
+  if (first == last)
+    return result;
+  __deque_segments<iterator> seg(first, last);
+  nthreads = __deque_parallel_split(seg, size_t(last - first), nthreads);
+  __parallel_batches work(seg.batches);
+  __deque_transform_worker<iterator, OutputIterator, UnaryOperation> worker;
+  worker.seg = &seg;
+  worker.work = &work;
+  worker.result = result;
+  worker.op = &op;
+  __parallel_run(nthreads, worker);
+  return result + (last - first);
+}
+
+// 返回op(...op(op(init, x0), x1)..., xn-1)按结合律重新组合后的结果
+// 元素类型必须可以转换为U
+template <__STL_DEQUE_ITER_PARAMS, class U, class BinaryOperation>
+U parallel_reduce(__STL_DEQUE_ITER first, __STL_DEQUE_ITER last, U init,
+                  BinaryOperation op, size_t nthreads = 0)
+{
+  typedef __STL_DEQUE_ITER iterator;
+  typedef simple_alloc<U, alloc> partial_allocator;
+  typedef simple_alloc<char, alloc> flag_allocator;
+
+  if (first == last)
+    return init;
+  __deque_segments<iterator> seg(first, last);
+  nthreads = __deque_parallel_split(seg, size_t(last - first), nthreads);
+  U* partial = partial_allocator::allocate(seg.batches);
+  char* has_partial = flag_allocator::allocate(seg.batches);
+
+  __parallel_batches work(seg.batches);
+  __deque_reduce_worker<iterator, U, BinaryOperation> worker;
+  worker.seg = &seg;
+  worker.work = &work;
+  worker.op = &op;
+  worker.partial = partial;
+  worker.has_partial = has_partial;
+  __parallel_run(nthreads, worker);
+
+  for (size_t b = 0; b < seg.batches; ++b)
+    if (has_partial[b]) {
+      init = op(init, partial[b]);
+      destroy(partial + b);
+    }
+  flag_allocator::deallocate(has_partial, seg.batches);
+  partial_allocator::deallocate(partial, seg.batches);
+  return init;
+}
+
+template <__STL_DEQUE_ITER_PARAMS, class U>
+inline U parallel_reduce(__STL_DEQUE_ITER first, __STL_DEQUE_ITER last,
+                         U init)
+{
+  return parallel_reduce(first, last, init, plus<U>());
+}
+
+template <__STL_DEQUE_ITER_PARAMS, class Predicate>
+ptrdiff_t parallel_count_if(__STL_DEQUE_ITER first, __STL_DEQUE_ITER last,
+                            Predicate pred, size_t nthreads = 0)
+{
+  typedef __STL_DEQUE_ITER iterator;
+  typedef simple_alloc<ptrdiff_t, alloc> count_allocator;
+
+  if (first == last)
+    return 0;
+  __deque_segments<iterator> seg(first, last);
+  nthreads = __deque_parallel_split(seg, size_t(last - first), nthreads);
+  ptrdiff_t* counts = count_allocator::allocate(seg.batches);
+
+  __parallel_batches work(seg.batches);
+  __deque_count_if_worker<iterator, Predicate> worker;
+  worker.seg = &seg;
+  worker.work = &work;
+  worker.pred = &pred;
+  worker.counts = counts;
+  __parallel_run(nthreads, worker);
+
+  ptrdiff_t n = 0;
+  for (size_t b = 0; b < seg.batches; ++b)
+    n += counts[b];
+  count_allocator::deallocate(counts, seg.batches);
+  return n;
+}
+
+// 返回第一个满足pred的元素, 和find_if的结果相同; 找到后尽早停止分配新的批次
+template <__STL_DEQUE_ITER_PARAMS, class Predicate>
+__STL_DEQUE_ITER parallel_find_if(__STL_DEQUE_ITER first,
+                                  __STL_DEQUE_ITER last,
+                                  Predicate pred, size_t nthreads = 0)
+{
+  typedef __STL_DEQUE_ITER iterator;
+  typedef T* pointer;
+  typedef simple_alloc<pointer, alloc> hit_allocator;
+  typedef simple_alloc<size_t, alloc> index_allocator;
+
+  if (first == last)
+    return last;
+  __deque_segments<iterator> seg(first, last);
+  nthreads = __deque_parallel_split(seg, size_t(last - first), nthreads);
+  pointer* hit = hit_allocator::allocate(seg.batches);
+  size_t* hit_segment = index_allocator::allocate(seg.batches);
+  fill(hit, hit + seg.batches, pointer(0));
+
+  __parallel_batches work(seg.batches);
+  __deque_find_if_worker<iterator, Predicate> worker;
+  worker.seg = &seg;
+  worker.work = &work;
+  worker.pred = &pred;
+  worker.hit = hit;
+  worker.hit_segment = hit_segment;
+  __parallel_run(nthreads, worker);
+
+  iterator result = last;
+  for (size_t b = 0; b < seg.batches; ++b)
+    if (hit[b]) {
+      result.set_node(first.node + hit_segment[b]);
+      result.cur = hit[b];
+      break;
+    }
+  index_allocator::deallocate(hit_segment, seg.batches);
+  hit_allocator::deallocate(hit, seg.batches);
+  return result;
+}
+
+// 并行排序: 段内排序按批分给各线程, 每轮归并中的各对有序段也分给各线程
+// 越往后有序段越少, 最后一轮只有一对, 由一个线程完成
+struct __deque_parallel_runner
+{
+  size_t nthreads;
+  __deque_parallel_runner(size_t n) : nthreads(n) {}
+};
+
+template <class Iterator, class Compare>
+struct __deque_sort_worker
+{
+  const __deque_segments<Iterator>* seg;
+  __parallel_batches* work;
+  Compare* comp;
+  bool stable;
+
+  void operator()(size_t)
+  {
+    size_t b;
+    while (work->next(b))
+      __deque_sort_segments(*seg, seg->batch_begin(b), seg->batch_end(b),
+                            *comp, stable);
+  }
+};
+
+template <class Source, class Dest, class Compare>
+struct __deque_merge_worker
+{
+  Source src;
+  Dest dst;
+  const ptrdiff_t* bounds;
+  size_t nruns;
+  __parallel_batches* work;
+  Compare* comp;
+
+  void operator()(size_t)
+  {
+    size_t j;
+    while (work->next(j))
+      __deque_merge_runs(src, dst, bounds, nruns, j, j + 1, *comp);
+  }
+};
+
+template <class Iterator, class Compare>
+void __deque_run_sort(__deque_parallel_runner run,
+                      const __deque_segments<Iterator>& seg,
+                      Compare comp, bool stable)
+{
+  __deque_segments<Iterator> s = seg;
+  size_t nthreads = __deque_parallel_split(s, size_t(s.last - s.first),
+                                           run.nthreads);
+  __parallel_batches work(s.batches);
+  __deque_sort_worker<Iterator, Compare> worker;
+  worker.seg = &s;
+  worker.work = &work;
+  worker.comp = &comp;
+  worker.stable = stable;
+  __parallel_run(nthreads, worker);
+}
+
+template <class Source, class Dest, class Compare>
+void __deque_run_merge(__deque_parallel_runner run, Source src, Dest dst,
+                       const ptrdiff_t* bounds, size_t nruns, Compare comp)
+{
+  size_t pairs = (nruns + 1) / 2;
+  size_t nthreads = run.nthreads;
+  if (size_t(bounds[nruns]) < __deque_parallel_threshold)
+    nthreads = 1;
+  if (nthreads > pairs)
+    nthreads = pairs;
+  __parallel_batches work(pairs);
+  __deque_merge_worker<Source, Dest, Compare> worker;
+  worker.src = src;
+  worker.dst = dst;
+  worker.bounds = bounds;
+  worker.nruns = nruns;
+  worker.work = &work;
+  worker.comp = &comp;
+  __parallel_run(nthreads, worker);
+}
+
+// 与deque_sort/deque_stable_sort的结果相同, comp同样被所有线程共享
+template <__STL_DEQUE_ITER_PARAMS, class Compare>
+void parallel_sort(__STL_DEQUE_ITER first, __STL_DEQUE_ITER last,
+                   Compare comp, size_t nthreads = 0)
+{
+  if (nthreads == 0)
+    nthreads = __parallel_default_threads();
+  __deque_segment_sort(first, last, comp, false,
+                       __deque_parallel_runner(nthreads));
+}
+
+template <__STL_DEQUE_ITER_PARAMS>
+inline void parallel_sort(__STL_DEQUE_ITER first, __STL_DEQUE_ITER last)
+{
+  parallel_sort(first, last, less<T>());
+}
+
+template <__STL_DEQUE_ITER_PARAMS, class Compare>
+void parallel_stable_sort(__STL_DEQUE_ITER first, __STL_DEQUE_ITER last,
+                          Compare comp, size_t nthreads = 0)
+{
+  if (nthreads == 0)
+    nthreads = __parallel_default_threads();
+  __deque_segment_sort(first, last, comp, true,
+                       __deque_parallel_runner(nthreads));
+}
+
+template <__STL_DEQUE_ITER_PARAMS>
+inline void parallel_stable_sort(__STL_DEQUE_ITER first,
+                                 __STL_DEQUE_ITER last)
+{
+  parallel_stable_sort(first, last, less<T>());
+}
+
+#undef __STL_DEQUE_ITER_PARAMS
+#undef __STL_DEQUE_ITER
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma reset woff 1174
+#endif
+
+__STL_END_NAMESPACE
+
+#endif /* __STL_PTHREADS */
+
+#endif /* __SGI_STL_INTERNAL_DEQUE_PARALLEL_H */
@@ -2,6 +2,11 @@
 #ifndef __SGI_STL_INTERNAL_HEAP_H
 #define __SGI_STL_INTERNAL_HEAP_H
 
+// 慢路径的计数和计时, 见<stl_instrument.h>; 没有打开时为空
+#ifndef __STL_PROBE
+#  define __STL_PROBE(probe)
+#endif
+
 __STL_BEGIN_NAMESPACE
 
 #if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
@@ -91,6 +96,7 @@ template <class RandomAccessIterator, class Distance, class T>
 void __adjust_heap(RandomAccessIterator first, Distance holeIndex,
 	Distance len, T value)
 {
+	__STL_PROBE(adjust_heap);
 	Distance topIndex = holeIndex;
 	Distance secondChild = 2 * holeIndex + 2;     // 弹出元素的有子孩
 
@@ -144,6 +150,7 @@ template <class RandomAccessIterator, class Distance, class T, class Compare>
 void __adjust_heap(RandomAccessIterator first, Distance holeIndex,
 	Distance len, T value, Compare comp)
 {
+	__STL_PROBE(adjust_heap);
 	Distance topIndex = holeIndex;
 	Distance secondChild = 2 * holeIndex + 2; //洞节点的右孩子节点
 	while (secondChild < len) {
@@ -0,0 +1,1017 @@
+// Filename:    stl_index_slist.h
+// 用32位下标链接的紧凑单链表
+//
+// slist的每个结点都是单独分配的, 除了数据还带着一个64位的next指针和分配器开销,
+// 对于大量的小元素(比如int), 指针和开销占了大部分内存
+// index_slist的所有结点都放在一块连续的、可增长的内存池里, 结点之间用32位下标链接:
+//   1. 对于int, 结点从16字节降到8字节, 也没有逐个分配的开销
+//   2. 链表里没有任何指针, 内存池可以整体搬移, POD类型的T还可以直接序列化
+// 接口和slist保持一致, 不同之处:
+//   1. 迭代器记录的是容器中内存池指针的地址和下标, 内存池增长后迭代器依然有效,
+//      但swap()之后迭代器指向的是另一个容器
+//   2. 两个index_slist的内存池是独立的, 在不同容器之间splice/merge只能复制元素,
+//      是O(n)的, 同一个容器内的splice依然是O(1)的
+//   3. 最多容纳2^32 - 2个元素
+
+#ifndef __SGI_STL_INTERNAL_INDEX_SLIST_H
+#define __SGI_STL_INTERNAL_INDEX_SLIST_H
+
+__STL_BEGIN_NAMESPACE
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma set woff 1174
+#endif
+
+typedef unsigned int __slist_index;
+
+// 空下标, 相当于slist中的0指针
+const __slist_index __slist_nil = __slist_index(-1);
+// 代表链表头的伪下标, 只用在内部以及previous(begin())的返回值上
+const __slist_index __slist_head = __slist_index(-2);
+
+template <class T>
+struct __index_slist_node
+{
+  __slist_index next;
+  T data;
+};
+
+template <class T, class Ref, class Ptr>
+struct __index_slist_iterator
+{
+  typedef __index_slist_iterator<T, T&, T*>             iterator;
+  typedef __index_slist_iterator<T, const T&, const T*> const_iterator;
+  typedef __index_slist_iterator<T, Ref, Ptr>           self;
+
+  typedef forward_iterator_tag iterator_category;
+  typedef T value_type;
+  typedef Ptr pointer;
+  typedef Ref reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+  typedef __index_slist_node<T> list_node;
+
+  list_node* const* pool;   // 指向容器中的内存池指针, 内存池搬移后依然有效
+  __slist_index index;
+
+  __index_slist_iterator(list_node* const* p, __slist_index i)
+    : pool(p), index(i) {}
+  __index_slist_iterator() : pool(0), index(__slist_nil) {}
+  __index_slist_iterator(const iterator& x) : pool(x.pool), index(x.index) {}
+
+  reference operator*() const { return (*pool)[index].data; }
+#ifndef __SGI_STL_NO_ARROW_OPERATOR
+  pointer operator->() const { return &(operator*()); }
+#endif /* __SGI_STL_NO_ARROW_OPERATOR */
+
+  self& operator++()
+  {
+    index = (*pool)[index].next;
+    return *this;
+  }
+  self operator++(int)
+  {
+    self tmp = *this;
+    ++*this;
+    return tmp;
+  }
+
+  // end()不属于任何容器, 所以只比较下标
+  bool operator==(const self& x) const { return index == x.index; }
+  bool operator!=(const self& x) const { return index != x.index; }
+};
+
+#ifndef __STL_CLASS_PARTIAL_SPECIALIZATION
+
+template <class T, class Ref, class Ptr>
+inline forward_iterator_tag
+iterator_category(const __index_slist_iterator<T, Ref, Ptr>&)
+{
+  return forward_iterator_tag();
+}
+
+template <class T, class Ref, class Ptr>
+inline T* value_type(const __index_slist_iterator<T, Ref, Ptr>&) { return 0; }
+
+template <class T, class Ref, class Ptr>
+inline ptrdiff_t* distance_type(const __index_slist_iterator<T, Ref, Ptr>&)
+{
+  return 0;
+}
+
+#endif /* __STL_CLASS_PARTIAL_SPECIALIZATION */
+
+// 把两条有序的下标链归并成一条, 相等时a中的元素在前
+template <class T, class StrictWeakOrdering>
+__slist_index __index_slist_merge_chains(__index_slist_node<T>* pool,
+                                         __slist_index a, __slist_index b,
+                                         StrictWeakOrdering comp)
+{
+  __slist_index result;
+  __slist_index* tail = &result;
+  while (a != __slist_nil && b != __slist_nil) {
+    if (comp(pool[b].data, pool[a].data)) {
+      *tail = b;
+      tail = &pool[b].next;
+      b = pool[b].next;
+    }
+    else {
+      *tail = a;
+      tail = &pool[a].next;
+      a = pool[a].next;
+    }
+  }
+  *tail = (a != __slist_nil) ? a : b;
+  return result;
+}
+
+// 和slist::sort()相同的自底向上归并排序, 只是链表换成了下标链
+template <class T, class StrictWeakOrdering>
+__slist_index __index_slist_sort(__index_slist_node<T>* pool,
+                                 __slist_index head, StrictWeakOrdering comp)
+{
+  __slist_index counter[64];
+  int fill = 0;
+  while (head != __slist_nil) {
+    __slist_index carry = head;
+    head = pool[head].next;
+    pool[carry].next = __slist_nil;
+    int i = 0;
+    while (i < fill && counter[i] != __slist_nil) {
+      carry = __index_slist_merge_chains(pool, counter[i], carry, comp);
+      counter[i] = __slist_nil;
+      ++i;
+    }
+    if (i == fill)
+      ++fill;
+    counter[i] = carry;
+  }
+
+  // counter[i]越大越早进入, 归并时放在左边才能保证稳定
+  __slist_index result = __slist_nil;
+  for (int i = 0; i < fill; ++i)
+    if (counter[i] != __slist_nil)
+      result = __index_slist_merge_chains(pool, counter[i], result, comp);
+  return result;
+}
+
+template <class T, class Alloc = alloc>
+class index_slist
+{
+public:
+  typedef T value_type;
+  typedef value_type* pointer;
+  typedef const value_type* const_pointer;
+  typedef value_type& reference;
+  typedef const value_type& const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  typedef __index_slist_iterator<T, T&, T*>             iterator;
+  typedef __index_slist_iterator<T, const T&, const T*> const_iterator;
+
+protected:
+  typedef __index_slist_node<T> list_node;
+  typedef simple_alloc<list_node, Alloc> pool_allocator;
+
+  list_node* pool;          // 所有结点所在的连续内存
+  __slist_index pool_size;  // 内存池的容量(结点个数)
+  __slist_index high;       // [0, high)是用过的槽位, 其后的槽位从未用过
+  __slist_index free_list;  // 被释放的槽位用next串起来
+  __slist_index head;       // 第一个结点的下标
+
+  // 下标i之后的链接, i可以是__slist_head
+  __slist_index& link(__slist_index i)
+  {
+    return i == __slist_head ? head : pool[i].next;
+  }
+  __slist_index link(__slist_index i) const
+  {
+    return i == __slist_head ? head : pool[i].next;
+  }
+
+  static __slist_index max_pool_size() { return __slist_head; }
+
+  // 内存池增长到n个结点, 平凡类型直接整体搬移
+  void grow(__slist_index n)
+  {
+    if (n <= pool_size)
+      return;
+    typedef typename __type_traits<T>::is_POD_type is_POD;
+    grow_aux(n, is_POD());
+  }
+
+  void grow_aux(__slist_index n, __true_type)
+  {
+    if (pool == 0)
+      pool = pool_allocator::allocate(n);
+    else
+      pool = (list_node*) Alloc::reallocate(pool,
+                                            pool_size * sizeof(list_node),
+                                            n * sizeof(list_node));
+    pool_size = n;
+  }
+
+  void grow_aux(__slist_index n, __false_type)
+  {
+    list_node* new_pool = pool_allocator::allocate(n);
+    __slist_index cur = head;
+    __STL_TRY {
+      for ( ; cur != __slist_nil; cur = pool[cur].next)
+        construct(&new_pool[cur].data, pool[cur].data);
+    }
+#     ifdef __STL_USE_EXCEPTIONS
+    catch(...) {
+      for (__slist_index i = head; i != cur; i = pool[i].next)
+        destroy(&new_pool[i].data);
+      pool_allocator::deallocate(new_pool, n);
+      throw;
+    }
+#     endif /* __STL_USE_EXCEPTIONS */
+    for (__slist_index i = 0; i < high; ++i)
+      new_pool[i].next = pool[i].next;
+    for (cur = head; cur != __slist_nil; cur = pool[cur].next)
+      destroy(&pool[cur].data);
+    if (pool)
+      pool_allocator::deallocate(pool, pool_size);
+    pool = new_pool;
+    pool_size = n;
+  }
+
+  bool full() const { return free_list == __slist_nil && high == pool_size; }
+
+  void grow_for_one()
+  {
+    if (pool_size == max_pool_size())
+      __THROW_BAD_ALLOC;
+    __slist_index n = pool_size ? pool_size : 4;
+    grow(n < max_pool_size() - n ? 2 * n : max_pool_size());
+  }
+
+  // 取一个空槽位, 调用前必须保证!full()
+  __slist_index get_slot()
+  {
+    if (free_list != __slist_nil) {
+      __slist_index i = free_list;
+      free_list = pool[i].next;
+      return i;
+    }
+    return high++;
+  }
+
+  void put_slot(__slist_index i)
+  {
+    pool[i].next = free_list;
+    free_list = i;
+  }
+
+  // x可能引用本容器中的元素, 内存池搬移前要先复制一份
+  __slist_index create_node(const value_type& x)
+  {
+    if (full()) {
+      value_type x_copy = x;
+      grow_for_one();
+      return create_node_aux(x_copy);
+    }
+    return create_node_aux(x);
+  }
+
+  __slist_index create_node_aux(const value_type& x)
+  {
+    __slist_index i = get_slot();
+    __STL_TRY {
+      construct(&pool[i].data, x);
+      pool[i].next = __slist_nil;
+    }
+    __STL_UNWIND(put_slot(i));
+    return i;
+  }
+
+  void destroy_node(__slist_index i)
+  {
+    destroy(&pool[i].data);
+    put_slot(i);
+  }
+
+  void init()
+  {
+    pool = 0;
+    pool_size = 0;
+    high = 0;
+    free_list = __slist_nil;
+    head = __slist_nil;
+  }
+
+  void fill_initialize(size_type n, const value_type& x)
+  {
+    init();
+    __STL_TRY {
+      reserve(n);
+      _insert_after_fill(__slist_head, n, x);
+    }
+    __STL_UNWIND(clear(); release());
+  }
+
+#ifdef __STL_MEMBER_TEMPLATES
+  template <class InputIterator>
+  void range_initialize(InputIterator first, InputIterator last)
+  {
+    init();
+    __STL_TRY {
+      _insert_after_range(__slist_head, first, last);
+    }
+    __STL_UNWIND(clear(); release());
+  }
+#else /* __STL_MEMBER_TEMPLATES */
+  void range_initialize(const value_type* first, const value_type* last)
+  {
+    init();
+    __STL_TRY {
+      reserve(last - first);
+      _insert_after_range(__slist_head, first, last);
+    }
+    __STL_UNWIND(clear(); release());
+  }
+  void range_initialize(const_iterator first, const_iterator last)
+  {
+    init();
+    __STL_TRY {
+      _insert_after_range(__slist_head, first, last);
+    }
+    __STL_UNWIND(clear(); release());
+  }
+#endif /* __STL_MEMBER_TEMPLATES */
+
+  // 释放内存池, 调用前所有元素必须已经析构
+  void release()
+  {
+    if (pool)
+      pool_allocator::deallocate(pool, pool_size);
+    init();
+  }
+
+public:
+  index_slist() { init(); }
+
+  index_slist(size_type n, const value_type& x) { fill_initialize(n, x); }
+  index_slist(int n, const value_type& x) { fill_initialize(n, x); }
+  index_slist(long n, const value_type& x) { fill_initialize(n, x); }
+  explicit index_slist(size_type n) { fill_initialize(n, value_type()); }
+
+#ifdef __STL_MEMBER_TEMPLATES
+  template <class InputIterator>
+  index_slist(InputIterator first, InputIterator last)
+  {
+    range_initialize(first, last);
+  }
+#else /* __STL_MEMBER_TEMPLATES */
+  index_slist(const_iterator first, const_iterator last)
+  {
+    range_initialize(first, last);
+  }
+  index_slist(const value_type* first, const value_type* last)
+  {
+    range_initialize(first, last);
+  }
+#endif /* __STL_MEMBER_TEMPLATES */
+
+  // 复制出来的链表下标是连续的, 相当于顺便整理了一次内存池
+  index_slist(const index_slist& L)
+  {
+    init();
+    __STL_TRY {
+      reserve(L.size());
+      _insert_after_range(__slist_head, L.begin(), L.end());
+    }
+    __STL_UNWIND(clear(); release());
+  }
+
+  index_slist& operator= (const index_slist& L);
+
+  ~index_slist()
+  {
+    clear();
+    release();
+  }
+
+public:
+  iterator begin() { return iterator(&pool, head); }
+  const_iterator begin() const
+  {
+    return const_iterator((list_node* const*) &pool, head);
+  }
+
+  iterator end() { return iterator(&pool, __slist_nil); }
+  const_iterator end() const
+  {
+    return const_iterator((list_node* const*) &pool, __slist_nil);
+  }
+
+  size_type size() const
+  {
+    size_type result = 0;
+    for (__slist_index i = head; i != __slist_nil; i = pool[i].next)
+      ++result;
+    return result;
+  }
+
+  size_type max_size() const { return size_type(max_pool_size()); }
+
+  bool empty() const { return head == __slist_nil; }
+
+  // 内存池的容量, 以及预先把内存池扩大到至少能放n个元素
+  size_type capacity() const { return pool_size; }
+  void reserve(size_type n)
+  {
+    if (n > max_size())
+      __THROW_BAD_ALLOC;
+    grow(__slist_index(n));
+  }
+
+  // 交换内存池即可, 迭代器不会跟着结点走
+  void swap(index_slist& L)
+  {
+    __STD::swap(pool, L.pool);
+    __STD::swap(pool_size, L.pool_size);
+    __STD::swap(high, L.high);
+    __STD::swap(free_list, L.free_list);
+    __STD::swap(head, L.head);
+  }
+
+public:
+  reference front() { return pool[head].data; }
+  const_reference front() const { return pool[head].data; }
+
+  void push_front(const value_type& x)
+  {
+    _insert_after(__slist_head, x);
+  }
+
+  void pop_front()
+  {
+    __slist_index i = head;
+    head = pool[i].next;
+    destroy_node(i);
+  }
+
+  // previous(begin())返回代表链表头的迭代器, 只能传给insert_after/erase_after,
+  // 不能解引用或者自增
+  iterator previous(const_iterator pos)
+  {
+    return iterator(&pool, _previous(__slist_head, pos.index));
+  }
+  const_iterator previous(const_iterator pos) const
+  {
+    return const_iterator((list_node* const*) &pool,
+                          _previous(__slist_head, pos.index));
+  }
+
+protected:
+  __slist_index _previous(__slist_index from, __slist_index node) const
+  {
+    while (link(from) != node)
+      from = link(from);
+    return from;
+  }
+
+  __slist_index _insert_after(__slist_index pos, const value_type& x)
+  {
+    __slist_index i = create_node(x);
+    pool[i].next = link(pos);
+    link(pos) = i;
+    return i;
+  }
+
+  void _insert_after_fill(__slist_index pos, size_type n, const value_type& x)
+  {
+    if (n == 0)
+      return;
+    value_type x_copy = x;
+    for (size_type i = 0; i < n; ++i)
+      pos = _insert_after(pos, x_copy);
+  }
+
+#ifdef __STL_MEMBER_TEMPLATES
+  template <class InIter>
+  void _insert_after_range(__slist_index pos, InIter first, InIter last)
+  {
+    while (first != last) {
+      pos = _insert_after(pos, *first);
+      ++first;
+    }
+  }
+#else /* __STL_MEMBER_TEMPLATES */
+  void _insert_after_range(__slist_index pos,
+                           const_iterator first, const_iterator last)
+  {
+    while (first != last) {
+      pos = _insert_after(pos, *first);
+      ++first;
+    }
+  }
+  void _insert_after_range(__slist_index pos,
+                           const value_type* first, const value_type* last)
+  {
+    while (first != last) {
+      pos = _insert_after(pos, *first);
+      ++first;
+    }
+  }
+#endif /* __STL_MEMBER_TEMPLATES */
+
+  __slist_index _erase_after(__slist_index pos)
+  {
+    __slist_index next = link(pos);
+    link(pos) = pool[next].next;
+    destroy_node(next);
+    return link(pos);
+  }
+
+  __slist_index _erase_after(__slist_index before_first,
+                             __slist_index last_node)
+  {
+    __slist_index cur = link(before_first);
+    while (cur != last_node) {
+      __slist_index tmp = cur;
+      cur = pool[cur].next;
+      destroy_node(tmp);
+    }
+    link(before_first) = last_node;
+    return last_node;
+  }
+
+  // 同一个容器内移动(before_first, before_last]到pos之后
+  void _splice_after(__slist_index pos,
+                     __slist_index before_first, __slist_index before_last)
+  {
+    if (pos != before_first && pos != before_last) {
+      __slist_index first = link(before_first);
+      __slist_index after = link(pos);
+      link(before_first) = link(before_last);
+      link(pos) = first;
+      link(before_last) = after;
+    }
+  }
+
+public:
+  iterator insert_after(iterator pos, const value_type& x)
+  {
+    return iterator(&pool, _insert_after(pos.index, x));
+  }
+
+  iterator insert_after(iterator pos)
+  {
+    return insert_after(pos, value_type());
+  }
+
+  void insert_after(iterator pos, size_type n, const value_type& x)
+  {
+    _insert_after_fill(pos.index, n, x);
+  }
+  void insert_after(iterator pos, int n, const value_type& x)
+  {
+    _insert_after_fill(pos.index, (size_type) n, x);
+  }
+  void insert_after(iterator pos, long n, const value_type& x)
+  {
+    _insert_after_fill(pos.index, (size_type) n, x);
+  }
+
+#ifdef __STL_MEMBER_TEMPLATES
+  template <class InIter>
+  void insert_after(iterator pos, InIter first, InIter last) {
+    _insert_after_range(pos.index, first, last);
+  }
+#else /* __STL_MEMBER_TEMPLATES */
+  void insert_after(iterator pos, const_iterator first, const_iterator last) {
+    _insert_after_range(pos.index, first, last);
+  }
+  void insert_after(iterator pos,
+                    const value_type* first, const value_type* last) {
+    _insert_after_range(pos.index, first, last);
+  }
+#endif /* __STL_MEMBER_TEMPLATES */
+
+  iterator insert(iterator pos, const value_type& x)
+  {
+    return iterator(&pool,
+                    _insert_after(_previous(__slist_head, pos.index), x));
+  }
+
+  iterator insert(iterator pos) { return insert(pos, value_type()); }
+
+  void insert(iterator pos, size_type n, const value_type& x)
+  {
+    _insert_after_fill(_previous(__slist_head, pos.index), n, x);
+  }
+  void insert(iterator pos, int n, const value_type& x)
+  {
+    insert(pos, (size_type) n, x);
+  }
+  void insert(iterator pos, long n, const value_type& x)
+  {
+    insert(pos, (size_type) n, x);
+  }
+
+#ifdef __STL_MEMBER_TEMPLATES
+  template <class InIter>
+  void insert(iterator pos, InIter first, InIter last) {
+    _insert_after_range(_previous(__slist_head, pos.index), first, last);
+  }
+#else /* __STL_MEMBER_TEMPLATES */
+  void insert(iterator pos, const_iterator first, const_iterator last) {
+    _insert_after_range(_previous(__slist_head, pos.index), first, last);
+  }
+  void insert(iterator pos, const value_type* first, const value_type* last) {
+    _insert_after_range(_previous(__slist_head, pos.index), first, last);
+  }
+#endif /* __STL_MEMBER_TEMPLATES */
+
+public:
+  iterator erase_after(iterator pos)
+  {
+    return iterator(&pool, _erase_after(pos.index));
+  }
+  iterator erase_after(iterator before_first, iterator last)
+  {
+    return iterator(&pool, _erase_after(before_first.index, last.index));
+  }
+
+  iterator erase(iterator pos)
+  {
+    return iterator(&pool,
+                    _erase_after(_previous(__slist_head, pos.index)));
+  }
+  iterator erase(iterator first, iterator last)
+  {
+    return iterator(&pool,
+                    _erase_after(_previous(__slist_head, first.index),
+                                 last.index));
+  }
+
+  void resize(size_type new_size, const T& x);
+  void resize(size_type new_size) { resize(new_size, T()); }
+
+  // 元素全部析构, 内存池保留, 槽位从头开始重新使用
+  void clear()
+  {
+    for (__slist_index i = head; i != __slist_nil; i = pool[i].next)
+      destroy(&pool[i].data);
+    head = __slist_nil;
+    free_list = __slist_nil;
+    high = 0;
+  }
+
+public:
+  // 下面两个只能在同一个容器内移动结点, O(1)
+  void splice_after(iterator pos, iterator before_first, iterator before_last)
+  {
+    if (before_first != before_last)
+      _splice_after(pos.index, before_first.index, before_last.index);
+  }
+
+  void splice_after(iterator pos, iterator prev)
+  {
+    _splice_after(pos.index, prev.index, link(prev.index));
+  }
+
+  // 下面这些如果L是另一个容器, 只能复制元素后再从L中擦除
+  void splice(iterator pos, index_slist& L)
+  {
+    if (&L != this && !L.empty()) {
+      insert(pos, L.begin(), L.end());
+      L.clear();
+    }
+  }
+
+  void splice(iterator pos, index_slist& L, iterator i)
+  {
+    if (&L == this)
+      _splice_after(_previous(__slist_head, pos.index),
+                    _previous(__slist_head, i.index), i.index);
+    else {
+      insert(pos, *i);
+      L.erase(i);
+    }
+  }
+
+  void splice(iterator pos, index_slist& L, iterator first, iterator last)
+  {
+    if (first == last)
+      return;
+    if (&L == this)
+      _splice_after(_previous(__slist_head, pos.index),
+                    _previous(__slist_head, first.index),
+                    _previous(first.index, last.index));
+    else {
+      insert(pos, first, last);
+      L.erase(first, last);
+    }
+  }
+
+public:
+  void reverse();
+
+  void remove(const T& val);
+  void unique();
+  void merge(index_slist& L);
+  void sort();
+
+#ifdef __STL_MEMBER_TEMPLATES
+  template <class Predicate> void remove_if(Predicate pred);
+  template <class BinaryPredicate> void unique(BinaryPredicate pred);
+  template <class StrictWeakOrdering>
+  void merge(index_slist&, StrictWeakOrdering comp);
+  template <class StrictWeakOrdering> void sort(StrictWeakOrdering comp);
+#endif /* __STL_MEMBER_TEMPLATES */
+
+public:
+  // 序列化, 只适用于POD类型的T(按__type_traits<T>::is_POD_type区分),
+  // 其他类型没有对应的serialize_aux()/deserialize_aux(), 编译时就会报错
+  // 链表中没有指针, 所以直接把头部信息和[0, high)的槽位原样写出即可,
+  // 读回时也是一次内存复制
+  size_type serialized_size() const
+  {
+    return 3 * sizeof(__slist_index) + high * sizeof(list_node);
+  }
+
+  void serialize(void* buf) const
+  {
+    typedef typename __type_traits<T>::is_POD_type is_POD;
+    serialize_aux(buf, is_POD());
+  }
+
+  // 用buf中bytes字节的映像替换链表的内容
+  // 映像不完整, 下标越界, 链接成环, 或者有槽位既不在链表中也不在空闲链表中时,
+  // 返回false, 链表保持原状
+  bool deserialize(const void* buf, size_type bytes)
+  {
+    typedef typename __type_traits<T>::is_POD_type is_POD;
+    return deserialize_aux(buf, bytes, is_POD());
+  }
+
+protected:
+  void serialize_aux(void* buf, __true_type) const
+  {
+    __slist_index header[3] = { head, free_list, high };
+    memcpy(buf, header, sizeof(header));
+    if (high)
+      memcpy((char*) buf + sizeof(header), pool, high * sizeof(list_node));
+  }
+
+  bool deserialize_aux(const void* buf, size_type bytes, __true_type);
+
+  // 从i开始沿链接走到__slist_nil, 每个槽位都必须小于n并且是第一次经过
+  static bool mark_chain(const list_node* p, char* seen, __slist_index n,
+                         __slist_index i, __slist_index& count)
+  {
+    for ( ; i != __slist_nil; i = p[i].next) {
+      if (i >= n || seen[i])
+        return false;
+      seen[i] = 1;
+      ++count;
+    }
+    return true;
+  }
+};
+
+// 先在新的内存池中检查链接, 通过后才替换原来的内存池;
+// [0, high)中的槽位恰好分成链表和空闲链表两条链
+template <class T, class Alloc>
+bool index_slist<T, Alloc>::deserialize_aux(const void* buf, size_type bytes,
+                                            __true_type)
+{
+  __slist_index header[3];
+  if (bytes < sizeof(header))
+    return false;
+  memcpy(header, buf, sizeof(header));
+  __slist_index n = header[2];
+  if (n > max_pool_size()
+      || (bytes - sizeof(header)) / sizeof(list_node) < n)
+    return false;
+
+  list_node* new_pool = n ? pool_allocator::allocate(n) : 0;
+  bool ok = true;
+  if (n) {
+    memcpy(new_pool, (const char*) buf + sizeof(header),
+           n * sizeof(list_node));
+    typedef simple_alloc<char, Alloc> mark_allocator;
+    char* seen = 0;
+    __STL_TRY {
+      seen = mark_allocator::allocate(n);
+    }
+    __STL_UNWIND(pool_allocator::deallocate(new_pool, n));
+    memset(seen, 0, n);
+    __slist_index count = 0;
+    ok = mark_chain(new_pool, seen, n, header[0], count)
+         && mark_chain(new_pool, seen, n, header[1], count)
+         && count == n;
+    mark_allocator::deallocate(seen, n);
+  }
+  else
+    ok = header[0] == __slist_nil && header[1] == __slist_nil;
+  if (!ok) {
+    if (new_pool)
+      pool_allocator::deallocate(new_pool, n);
+    return false;
+  }
+
+  clear();
+  if (pool)
+    pool_allocator::deallocate(pool, pool_size);
+  pool = new_pool;
+  pool_size = n;
+  head = header[0];
+  free_list = header[1];
+  high = n;
+  return true;
+}
+
+template <class T, class Alloc>
+index_slist<T, Alloc>& index_slist<T, Alloc>::operator=(const index_slist& L)
+{
+  if (&L != this) {
+    __slist_index p1 = __slist_head;
+    __slist_index n1 = head;
+    __slist_index n2 = L.head;
+    while (n1 != __slist_nil && n2 != __slist_nil) {
+      pool[n1].data = L.pool[n2].data;
+      p1 = n1;
+      n1 = pool[n1].next;
+      n2 = L.pool[n2].next;
+    }
+    if (n2 == __slist_nil)
+      _erase_after(p1, __slist_nil);
+    else
+      _insert_after_range(p1, const_iterator((list_node* const*) &L.pool, n2),
+                          L.end());
+  }
+  return *this;
+}
+
+template <class T, class Alloc>
+bool operator==(const index_slist<T, Alloc>& L1,
+                const index_slist<T, Alloc>& L2)
+{
+  typedef typename index_slist<T, Alloc>::const_iterator const_iterator;
+  const_iterator i1 = L1.begin();
+  const_iterator i2 = L2.begin();
+  while (i1 != L1.end() && i2 != L2.end() && *i1 == *i2) {
+    ++i1;
+    ++i2;
+  }
+  return i1 == L1.end() && i2 == L2.end();
+}
+
+template <class T, class Alloc>
+inline bool operator<(const index_slist<T, Alloc>& L1,
+                      const index_slist<T, Alloc>& L2)
+{
+  return lexicographical_compare(L1.begin(), L1.end(), L2.begin(), L2.end());
+}
+
+#ifdef __STL_FUNCTION_TMPL_PARTIAL_ORDER
+
+template <class T, class Alloc>
+inline void swap(index_slist<T, Alloc>& x, index_slist<T, Alloc>& y) {
+  x.swap(y);
+}
+
+#endif /* __STL_FUNCTION_TMPL_PARTIAL_ORDER */
+
+// 下面这些和slist中的实现一致, 只是指针换成了下标
+template <class T, class Alloc>
+void index_slist<T, Alloc>::resize(size_type len, const T& x)
+{
+  __slist_index cur = __slist_head;
+  while (link(cur) != __slist_nil && len > 0) {
+    --len;
+    cur = link(cur);
+  }
+  if (link(cur) != __slist_nil)
+    _erase_after(cur, __slist_nil);
+  else
+    _insert_after_fill(cur, len, x);
+}
+
+template <class T, class Alloc>
+void index_slist<T, Alloc>::reverse()
+{
+  __slist_index result = __slist_nil;
+  __slist_index node = head;
+  while (node != __slist_nil) {
+    __slist_index next = pool[node].next;
+    pool[node].next = result;
+    result = node;
+    node = next;
+  }
+  head = result;
+}
+
+template <class T, class Alloc>
+void index_slist<T, Alloc>::remove(const T& val)
+{
+  __slist_index cur = __slist_head;
+  while (link(cur) != __slist_nil) {
+    if (pool[link(cur)].data == val)
+      _erase_after(cur);
+    else
+      cur = link(cur);
+  }
+}
+
+template <class T, class Alloc>
+void index_slist<T, Alloc>::unique()
+{
+  __slist_index cur = head;
+  if (cur != __slist_nil) {
+    while (pool[cur].next != __slist_nil) {
+      if (pool[cur].data == pool[pool[cur].next].data)
+        _erase_after(cur);
+      else
+        cur = pool[cur].next;
+    }
+  }
+}
+
+// L中的元素复制到本容器, 相等时本容器的元素在前, 和slist::merge()一致
+template <class T, class Alloc>
+void index_slist<T, Alloc>::merge(index_slist<T, Alloc>& L)
+{
+  if (&L == this)
+    return;
+  __slist_index prev = __slist_head;
+  for (const_iterator j = L.begin(); j != L.end(); ++j) {
+    while (link(prev) != __slist_nil && !(*j < pool[link(prev)].data))
+      prev = link(prev);
+    prev = _insert_after(prev, *j);
+  }
+  L.clear();
+}
+
+template <class T, class Alloc>
+void index_slist<T, Alloc>::sort()
+{
+  if (head != __slist_nil && pool[head].next != __slist_nil)
+    head = __index_slist_sort(pool, head, less<T>());
+}
+
+#ifdef __STL_MEMBER_TEMPLATES
+
+template <class T, class Alloc>
+template <class Predicate> void index_slist<T, Alloc>::remove_if(Predicate pred)
+{
+  __slist_index cur = __slist_head;
+  while (link(cur) != __slist_nil) {
+    if (pred(pool[link(cur)].data))
+      _erase_after(cur);
+    else
+      cur = link(cur);
+  }
+}
+
+template <class T, class Alloc> template <class BinaryPredicate>
+void index_slist<T, Alloc>::unique(BinaryPredicate pred)
+{
+  __slist_index cur = head;
+  if (cur != __slist_nil) {
+    while (pool[cur].next != __slist_nil) {
+      if (pred(pool[cur].data, pool[pool[cur].next].data))
+        _erase_after(cur);
+      else
+        cur = pool[cur].next;
+    }
+  }
+}
+
+template <class T, class Alloc> template <class StrictWeakOrdering>
+void index_slist<T, Alloc>::merge(index_slist<T, Alloc>& L,
+                                  StrictWeakOrdering comp)
+{
+  if (&L == this)
+    return;
+  __slist_index prev = __slist_head;
+  for (const_iterator j = L.begin(); j != L.end(); ++j) {
+    while (link(prev) != __slist_nil && !comp(*j, pool[link(prev)].data))
+      prev = link(prev);
+    prev = _insert_after(prev, *j);
+  }
+  L.clear();
+}
+
+template <class T, class Alloc> template <class StrictWeakOrdering>
+void index_slist<T, Alloc>::sort(StrictWeakOrdering comp)
+{
+  if (head != __slist_nil && pool[head].next != __slist_nil)
+    head = __index_slist_sort(pool, head, comp);
+}
+
+#endif /* __STL_MEMBER_TEMPLATES */
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma reset woff 1174
+#endif
+
+__STL_END_NAMESPACE
+
+#endif /* __SGI_STL_INTERNAL_INDEX_SLIST_H */
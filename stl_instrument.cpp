@@ -0,0 +1,184 @@
+// Filename:    stl_instrument.h
+// 容器慢路径的计数与计时
+//
+// deque的push_back_aux()/reallocate_map()等, slist的__slist_previous()
+// 和heap的__adjust_heap()在代码中用__STL_PROBE(名字)标出
+// 默认(没有定义__STL_INSTRUMENT)时__STL_PROBE展开为空, 没有任何开销
+// 定义__STL_INSTRUMENT并在<stl_deque.h>, <stl_slist.h>, <stl_heap.h>
+// 之前包含本文件后, 每个探针:
+//   每次经过都计数;
+//   每__STL_INSTRUMENT_SAMPLE次(2的幂, 默认64)计时一次,
+//   记录计时的次数, 总时间和最长的一次; 定义为0时只计数不计时
+// 定义了__STL_PTHREADS时计数用原子加法, 可以在多个线程中使用
+//
+// 导出:
+//   stl_instrument_snapshot(out, n)  把各探针的当前值复制到out[0, n),
+//                                    返回探针总数
+//   stl_instrument_reset()           清零
+// 计时的总时间除以计时的次数是平均耗时的估计, 乘以计数是总耗时的估计
+
+#ifndef __SGI_STL_INTERNAL_INSTRUMENT_H
+#define __SGI_STL_INTERNAL_INSTRUMENT_H
+
+#ifdef __STL_INSTRUMENT
+#  include <time.h>
+#endif
+
+__STL_BEGIN_NAMESPACE
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma set woff 1174
+#endif
+
+// 探针编号, 和__stl_probe_name()中的名字一一对应
+enum __stl_probe_id {
+  __stl_probe_deque_push_back_aux,
+  __stl_probe_deque_push_front_aux,
+  __stl_probe_deque_pop_back_aux,
+  __stl_probe_deque_pop_front_aux,
+  __stl_probe_deque_reallocate_map,
+  __stl_probe_slist_previous,
+  __stl_probe_adjust_heap,
+  __stl_probe_count
+};
+
+struct stl_probe_stats {
+  const char* name;
+  unsigned long calls;
+  unsigned long samples;        // 计时的次数
+  unsigned long total_ns;       // 计时的总时间
+  unsigned long max_ns;         // 最长的一次
+};
+
+inline const char* __stl_probe_name(int id)
+{
+  static const char* const names[__stl_probe_count] = {
+    "deque::push_back_aux",
+    "deque::push_front_aux",
+    "deque::pop_back_aux",
+    "deque::pop_front_aux",
+    "deque::reallocate_map",
+    "__slist_previous",
+    "__adjust_heap"
+  };
+  return names[id];
+}
+
+#ifdef __STL_INSTRUMENT
+
+#ifndef __STL_INSTRUMENT_SAMPLE
+#  define __STL_INSTRUMENT_SAMPLE 64
+#endif
+
+template <int inst>
+struct __stl_instrument_data
+{
+  static stl_probe_stats probes[__stl_probe_count];
+
+  // 返回加之前的值
+  static unsigned long add(unsigned long& x, unsigned long v)
+  {
+#if defined(__STL_PTHREADS) && defined(__GNUC__)
+    return __sync_fetch_and_add(&x, v);
+#else
+    unsigned long old = x;
+    x += v;
+    return old;
+#endif
+  }
+
+  // max_ns只是统计值, 并发时偶尔丢失一次更新可以接受
+  static void record(int id, unsigned long ns)
+  {
+    stl_probe_stats& p = probes[id];
+    add(p.samples, 1);
+    add(p.total_ns, ns);
+    if (ns > p.max_ns)
+      p.max_ns = ns;
+  }
+
+  static unsigned long now_ns()
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long) ts.tv_sec * 1000000000UL + ts.tv_nsec;
+  }
+};
+
+template <int inst>
+stl_probe_stats __stl_instrument_data<inst>::probes[__stl_probe_count];
+
+typedef __stl_instrument_data<0> __stl_instrument;
+
+// __STL_PROBE在函数开头定义一个这样的对象, 析构时结束计时
+class __stl_probe_scope
+{
+private:
+  int id;
+  unsigned long start;          // 0表示这次不计时
+
+public:
+  explicit __stl_probe_scope(int probe) : id(probe), start(0)
+  {
+    unsigned long n = __stl_instrument::add(
+      __stl_instrument::probes[probe].calls, 1);
+    if (__STL_INSTRUMENT_SAMPLE != 0
+        && (n & ((unsigned long) __STL_INSTRUMENT_SAMPLE - 1)) == 0)
+      start = __stl_instrument::now_ns();
+  }
+
+  ~__stl_probe_scope()
+  {
+    if (start)
+      __stl_instrument::record(id, __stl_instrument::now_ns() - start);
+  }
+};
+
+#undef __STL_PROBE
+#define __STL_PROBE(probe) \
+  __stl_probe_scope __stl_probe_guard(__stl_probe_##probe)
+
+inline size_t stl_instrument_snapshot(stl_probe_stats* out, size_t n)
+{
+  for (size_t i = 0; i < n && i < size_t(__stl_probe_count); ++i) {
+    out[i] = __stl_instrument::probes[i];
+    out[i].name = __stl_probe_name(int(i));
+  }
+  return __stl_probe_count;
+}
+
+inline void stl_instrument_reset()
+{
+  for (int i = 0; i < __stl_probe_count; ++i) {
+    stl_probe_stats& p = __stl_instrument::probes[i];
+    p.calls = p.samples = p.total_ns = p.max_ns = 0;
+  }
+}
+
+#else /* __STL_INSTRUMENT */
+
+// 没有打开时接口仍然存在, 所有值都是0
+inline size_t stl_instrument_snapshot(stl_probe_stats* out, size_t n)
+{
+  for (size_t i = 0; i < n && i < size_t(__stl_probe_count); ++i) {
+    stl_probe_stats zero = { __stl_probe_name(int(i)), 0, 0, 0, 0 };
+    out[i] = zero;
+  }
+  return __stl_probe_count;
+}
+
+inline void stl_instrument_reset() {}
+
+#endif /* __STL_INSTRUMENT */
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma reset woff 1174
+#endif
+
+__STL_END_NAMESPACE
+
+#endif /* __SGI_STL_INTERNAL_INSTRUMENT_H */
+
+// Local Variables:
+// mode:C++
+// End:
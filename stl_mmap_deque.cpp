@@ -0,0 +1,484 @@
+// Filename:    stl_mmap_deque.h
+// 以文件为后备存储的队列: 缓冲区是文件中的定长段, map也保存在文件里
+//
+// 结构和deque相同, 只是所有数据都放在一个文件中, 文件按段(segment)划分:
+//   段0            文件头, 记录map的位置和队列的起止状态, 见__mmap_deque_header
+//   map所在的段    map是一个段号数组, [map_first, map_first + map_count)
+//                  依次是使用中的段, 相当于deque的[start.node, finish.node]
+//   其余的段       数据段(相当于deque的缓冲区)或者空闲段
+// 内存中只映射文件头, map, 以及头尾两个数据段, 其余的数据交给操作系统换出,
+// 所以队列可以远大于物理内存; 头部弹空的段进入空闲链表, 尾部需要新段时优先使用,
+// 一个稳定收发的队列不会让文件无限增长
+//
+// 注意:
+//   1. 只能存放POD类型: 元素按字节写入文件, 下次打开时直接使用, 不会再构造
+//   2. 文件格式依赖于sizeof(size_t)和字节序, 不能跨平台使用
+//   3. 正常close()或者析构后, 重新open()可以得到原来的队列;
+//      sync()之后的状态在系统崩溃时也不会丢失, 两次sync()之间的操作则不保证
+//   4. 打开失败时open()返回false; 磁盘空间不足或者映射失败时
+//      push_back()和pop_front()抛出bad_alloc, 队列保持原状
+//   5. 需要POSIX的mmap, 不是线程安全的
+// 使用前需要先包含<stl_deque.h>
+
+#ifndef __SGI_STL_INTERNAL_MMAP_DEQUE_H
+#define __SGI_STL_INTERNAL_MMAP_DEQUE_H
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+
+__STL_BEGIN_NAMESPACE
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma set woff 1174
+#endif
+
+// 默认的段大小, 打开已有的文件时使用文件中记录的大小
+static const size_t __mmap_deque_default_segment = 1 << 20;
+
+// 位于文件开头
+struct __mmap_deque_header
+{
+  char magic[8];
+  size_t elem_size;             // sizeof(T), 打开时检查
+  size_t seg_bytes;             // 段的字节数, 页大小的整数倍
+  size_t nslots;                // 文件中的段数, 文件大小 = nslots * seg_bytes
+  size_t map_slot;              // map从这个段开始, 占连续的若干段
+  size_t map_capacity;          // map的槽位数
+  size_t map_first;             // 第一个使用中的槽位
+  size_t map_count;             // 使用中的槽位数, 至少为1
+  size_t head;                  // 第一个元素在第一个段中的下标
+  size_t tail;                  // 最后一个段中第一个空位的下标
+  size_t free_slot;             // 空闲段链表, 每个空闲段开头存放下一个空闲段号;
+                                // 段0是文件头, 所以0表示链表为空
+};
+
+static const char __mmap_deque_magic[8] = { 'S', 'G', 'I', 'M', 'D', 'Q', '1', 0 };
+
+template <class T>
+class mmap_deque
+{
+public:
+  typedef T value_type;
+  typedef value_type* pointer;
+  typedef value_type& reference;
+  typedef const value_type& const_reference;
+  typedef size_t size_type;
+
+protected:
+  int fd;
+  size_type page;
+  __mmap_deque_header* hdr;
+  size_type* map;               // 映射到内存的map
+  size_type map_bytes;          // map映射的字节数
+  pointer head_seg;             // 第一个数据段的映射
+  pointer tail_seg;             // 最后一个数据段的映射, 只有一个段时和head_seg相同
+
+public:
+  mmap_deque()
+    : fd(-1), page(0), hdr(0), map(0), map_bytes(0), head_seg(0), tail_seg(0)
+  {}
+
+  ~mmap_deque() { close(); }
+
+  // 打开path, 文件不存在或者为空时新建一个空队列
+  // seg_bytes只在新建时使用, 会向上取整到页大小的整数倍
+  bool open(const char* path,
+            size_type seg_bytes = __mmap_deque_default_segment);
+  void close();
+  bool is_open() const { return fd >= 0; }
+
+  // 把所有修改写回磁盘并等待写入完成, 包括已经解除映射的段和文件长度的变化
+  // 队列没有打开或者写回失败时返回false
+  bool sync();
+
+public:
+  // 以下操作要求队列已经打开
+  size_type segment_elements() const { return hdr->seg_bytes / sizeof(T); }
+  size_type size() const
+  {
+    return (hdr->map_count - 1) * segment_elements() + hdr->tail - hdr->head;
+  }
+  bool empty() const { return hdr->map_count == 1 && hdr->head == hdr->tail; }
+
+  reference front() { return head_seg[hdr->head]; }
+  const_reference front() const { return head_seg[hdr->head]; }
+  reference back() { return tail_seg[hdr->tail - 1]; }
+  const_reference back() const { return tail_seg[hdr->tail - 1]; }
+
+  // 最后一个段满了才需要新的段, 见push_back_aux()
+  void push_back(const value_type& x)
+  {
+    if (hdr->tail != segment_elements()) {
+      construct(tail_seg + hdr->tail, x);
+      ++hdr->tail;
+    }
+    else
+      push_back_aux(x);
+  }
+
+  // 弹出第一个段的最后一个元素时换到下一个段, 见pop_front_aux();
+  // 队列变空时从段的开头重新使用
+  void pop_front()
+  {
+    if (hdr->head + 1 == segment_elements() && hdr->map_count != 1) {
+      pop_front_aux();
+      return;
+    }
+    destroy(head_seg + hdr->head);
+    ++hdr->head;
+    if (empty()) {
+      hdr->head = 0;
+      hdr->tail = 0;
+    }
+  }
+
+  void clear();
+
+protected:
+  void push_back_aux(const value_type& x);
+  void pop_front_aux();
+
+  pointer map_segment(size_type slot);
+  void unmap_segment(pointer seg)
+  {
+    if (seg)
+      munmap(seg, hdr->seg_bytes);
+  }
+  size_type allocate_slot();
+  void free_slot(size_type slot, pointer seg);
+  size_type extend_file(size_type slots);
+  void truncate_file(size_type slots);
+  void reserve_map_at_back();
+  bool create(size_type seg_bytes);
+  void drop_mappings();
+
+private:
+  // 文件描述符和映射不能复制
+  mmap_deque(const mmap_deque&);
+  mmap_deque& operator=(const mmap_deque&);
+};
+
+template <class T>
+bool mmap_deque<T>::open(const char* path, size_type seg_bytes)
+{
+  close();
+  page = size_type(sysconf(_SC_PAGESIZE));
+  fd = ::open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close();
+    return false;
+  }
+  if (st.st_size == 0) {
+    if (seg_bytes < sizeof(T))
+      seg_bytes = sizeof(T);
+    seg_bytes = (seg_bytes + page - 1) / page * page;
+    if (!create(seg_bytes)) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  // 已有的文件: 检查文件头, 再映射map和头尾两个段
+  if (size_t(st.st_size) < page) {
+    close();
+    return false;
+  }
+  void* h = mmap(0, page, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (h == MAP_FAILED) {
+    close();
+    return false;
+  }
+  hdr = (__mmap_deque_header*) h;
+  if (memcmp(hdr->magic, __mmap_deque_magic, sizeof(hdr->magic)) != 0
+      || hdr->elem_size != sizeof(T)
+      || size_t(st.st_size) < hdr->nslots * hdr->seg_bytes) {
+    close();
+    return false;
+  }
+
+  map_bytes = hdr->map_capacity * sizeof(size_type);
+  void* m = mmap(0, map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                 off_t(hdr->map_slot * hdr->seg_bytes));
+  if (m == MAP_FAILED) {
+    map_bytes = 0;
+    close();
+    return false;
+  }
+  map = (size_type*) m;
+
+  head_seg = map_segment(map[hdr->map_first]);
+  tail_seg = hdr->map_count == 1
+               ? head_seg
+               : map_segment(map[hdr->map_first + hdr->map_count - 1]);
+  if (!head_seg || !tail_seg) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+// 新文件: 段0是文件头, 段1是map, 段2是第一个数据段
+template <class T>
+bool mmap_deque<T>::create(size_type seg_bytes)
+{
+  if (ftruncate(fd, off_t(3 * seg_bytes)) != 0)
+    return false;
+  void* h = mmap(0, page, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (h == MAP_FAILED)
+    return false;
+  hdr = (__mmap_deque_header*) h;
+  hdr->elem_size = sizeof(T);
+  hdr->seg_bytes = seg_bytes;
+  hdr->nslots = 3;
+  hdr->map_slot = 1;
+  hdr->map_capacity = seg_bytes / sizeof(size_type);
+  hdr->map_first = 0;
+  hdr->map_count = 1;
+  hdr->head = 0;
+  hdr->tail = 0;
+  hdr->free_slot = 0;
+
+  map_bytes = seg_bytes;
+  void* m = mmap(0, map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                 off_t(seg_bytes));
+  if (m == MAP_FAILED) {
+    map_bytes = 0;
+    return false;
+  }
+  map = (size_type*) m;
+  map[0] = 2;
+
+  head_seg = map_segment(2);
+  tail_seg = head_seg;
+  if (!head_seg)
+    return false;
+
+  // 其余字段都写好之后才写入magic, 写到一半的文件不会被当成合法的队列
+  memcpy(hdr->magic, __mmap_deque_magic, sizeof(hdr->magic));
+  return true;
+}
+
+template <class T>
+void mmap_deque<T>::drop_mappings()
+{
+  if (hdr) {
+    if (tail_seg != head_seg)
+      unmap_segment(tail_seg);
+    unmap_segment(head_seg);
+    if (map)
+      munmap(map, map_bytes);
+    munmap(hdr, page);
+  }
+  hdr = 0;
+  map = 0;
+  map_bytes = 0;
+  head_seg = 0;
+  tail_seg = 0;
+}
+
+// 解除映射后修改仍在页缓存中, 由操作系统写回; 需要落盘时先调用sync()
+template <class T>
+void mmap_deque<T>::close()
+{
+  drop_mappings();
+  if (fd >= 0)
+    ::close(fd);
+  fd = -1;
+}
+
+template <class T>
+bool mmap_deque<T>::sync()
+{
+  if (hdr == 0)
+    return false;
+  bool ok = msync(head_seg, hdr->seg_bytes, MS_SYNC) == 0;
+  if (tail_seg != head_seg)
+    ok = msync(tail_seg, hdr->seg_bytes, MS_SYNC) == 0 && ok;
+  ok = msync(map, map_bytes, MS_SYNC) == 0 && ok;
+  ok = msync(hdr, page, MS_SYNC) == 0 && ok;
+  // 已经解除映射的段(尾部写满后换下的段, clear()释放的段)只在页缓存中,
+  // 文件长度的变化也要写回, 这些只能通过fsync()
+  ok = fsync(fd) == 0 && ok;
+  return ok;
+}
+
+template <class T>
+typename mmap_deque<T>::pointer mmap_deque<T>::map_segment(size_type slot)
+{
+  void* p = mmap(0, hdr->seg_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                 off_t(slot * hdr->seg_bytes));
+  return p == MAP_FAILED ? pointer(0) : pointer(p);
+}
+
+// 在文件末尾增加slots个段, 返回第一个新段的段号
+// 失败时抛出bad_alloc, 文件头不变
+template <class T>
+typename mmap_deque<T>::size_type mmap_deque<T>::extend_file(size_type slots)
+{
+  size_type first = hdr->nslots;
+  if (ftruncate(fd, off_t((first + slots) * hdr->seg_bytes)) != 0)
+    __THROW_BAD_ALLOC;
+  hdr->nslots = first + slots;
+  return first;
+}
+
+// 撤销extend_file(): 新段映射失败时把文件缩回slots个段
+// 缩小失败也没有关系, 文件比nslots * seg_bytes长时open()仍然接受
+template <class T>
+void mmap_deque<T>::truncate_file(size_type slots)
+{
+  hdr->nslots = slots;
+  ftruncate(fd, off_t(slots * hdr->seg_bytes));
+}
+
+// 优先使用空闲链表中的段, 否则扩展文件
+// 空闲段的下一个段号存放在它自己的开头, 需要先映射才能读到,
+// 所以链表在push_back_aux()中映射好新段之后才真正摘下, 见那里
+template <class T>
+typename mmap_deque<T>::size_type mmap_deque<T>::allocate_slot()
+{
+  if (hdr->free_slot)
+    return hdr->free_slot;
+  return extend_file(1);
+}
+
+// seg是slot的映射
+template <class T>
+void mmap_deque<T>::free_slot(size_type slot, pointer seg)
+{
+  *(size_type*) seg = hdr->free_slot;
+  hdr->free_slot = slot;
+}
+
+// map尾部没有空位时, 先试着把使用中的槽位整体搬到开头
+// (只有尾部增长, 头部的空位都是弹出留下的), 不够再换一个两倍大的map
+// 新map写好之后才修改文件头, 旧map所在的段放回空闲链表
+template <class T>
+void mmap_deque<T>::reserve_map_at_back()
+{
+  size_type first = hdr->map_first;
+  size_type count = hdr->map_count;
+  if (first + count < hdr->map_capacity)
+    return;
+
+  if (2 * count <= hdr->map_capacity) {
+    memmove(map, map + first, count * sizeof(size_type));
+    hdr->map_first = 0;
+    return;
+  }
+
+  size_type old_slot = hdr->map_slot;
+  size_type old_slots = map_bytes / hdr->seg_bytes;
+  size_type new_slots = 2 * old_slots;
+  size_type new_bytes = new_slots * hdr->seg_bytes;
+  size_type new_slot = extend_file(new_slots);
+  void* m = mmap(0, new_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                 off_t(new_slot * hdr->seg_bytes));
+  if (m == MAP_FAILED) {
+    truncate_file(new_slot);
+    __THROW_BAD_ALLOC;
+  }
+  size_type* new_map = (size_type*) m;
+  memcpy(new_map, map + first, count * sizeof(size_type));
+
+  hdr->map_slot = new_slot;
+  hdr->map_capacity = new_bytes / sizeof(size_type);
+  hdr->map_first = 0;
+  munmap(map, map_bytes);
+  map = new_map;
+  map_bytes = new_bytes;
+
+  for (size_type i = 0; i < old_slots; ++i) {
+    pointer seg = map_segment(old_slot + i);
+    if (seg) {
+      free_slot(old_slot + i, seg);
+      unmap_segment(seg);
+    }
+  }
+}
+
+// 最后一个段已满: 取得一个新段并映射好, 再修改文件头
+template <class T>
+void mmap_deque<T>::push_back_aux(const value_type& x)
+{
+  reserve_map_at_back();
+  size_type slot = allocate_slot();
+  pointer seg = map_segment(slot);
+  if (!seg) {
+    if (slot != hdr->free_slot)         // 刚由extend_file()增加的段
+      truncate_file(slot);
+    __THROW_BAD_ALLOC;
+  }
+  if (slot == hdr->free_slot)
+    hdr->free_slot = *(size_type*) seg;
+
+  construct(seg, x);
+  map[hdr->map_first + hdr->map_count] = slot;
+  ++hdr->map_count;
+  hdr->tail = 1;
+  if (tail_seg != head_seg)
+    unmap_segment(tail_seg);
+  tail_seg = seg;
+}
+
+// 第一个段即将弹空, 后面还有段: 先映射好下一个段, 再把第一个段放回空闲链表
+// 并修改文件头; 映射失败时什么都没有改变
+template <class T>
+void mmap_deque<T>::pop_front_aux()
+{
+  pointer next = tail_seg;
+  if (hdr->map_count != 2) {
+    next = map_segment(map[hdr->map_first + 1]);
+    if (!next)
+      __THROW_BAD_ALLOC;
+  }
+
+  destroy(head_seg + hdr->head);
+  free_slot(map[hdr->map_first], head_seg);
+  ++hdr->map_first;
+  --hdr->map_count;
+  hdr->head = 0;
+  unmap_segment(head_seg);
+  head_seg = next;
+}
+
+// 除了第一个段, 使用中的段都放回空闲链表, 文件不缩小
+template <class T>
+void mmap_deque<T>::clear()
+{
+  for (size_type i = 1; i < hdr->map_count; ++i) {
+    size_type slot = map[hdr->map_first + i];
+    pointer seg = map_segment(slot);
+    if (seg) {
+      free_slot(slot, seg);
+      unmap_segment(seg);
+    }
+  }
+  if (tail_seg != head_seg)
+    unmap_segment(tail_seg);
+  tail_seg = head_seg;
+  hdr->map_count = 1;
+  hdr->head = 0;
+  hdr->tail = 0;
+}
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma reset woff 1174
+#endif
+
+__STL_END_NAMESPACE
+
+#endif /* __SGI_STL_INTERNAL_MMAP_DEQUE_H */
+
+// Local Variables:
+// mode:C++
+// End:
@@ -0,0 +1,239 @@
+// Filename:    stl_numa_alloc.h
+// 从2MB透明大页区域中分配内存的配置器, 可以按NUMA结点分开
+//
+// 配置器的接口和<stl_alloc.h>中的alloc相同, 用作deque等容器的Alloc参数:
+//   deque<T, hugepage_alloc>   缓冲区都从2MB对齐并且madvise(MADV_HUGEPAGE)过的
+//                              区域中切出, 相邻的缓冲区共享一个大页, TLB项少得多
+//   deque<T, numa_alloc>       同上, 另外每个NUMA结点各有自己的区域,
+//                              缓冲区来自调用allocate()的线程当时所在的结点,
+//                              新区域在第一次访问之前用mbind()绑定到该结点
+//
+// 不超过__hugepage_max_small字节的请求按64字节取整, 从区域中切出,
+// 释放后挂在对应结点, 对应大小的自由链表上, 区域本身从不归还系统;
+// 更大的请求(比如很大的map)直接mmap, 释放时munmap
+// 定义了__STL_PTHREADS时每个结点有一把锁, 否则不是线程安全的
+// 只在Linux上有大页和NUMA的效果, 其他系统上只是一个按区域分配的配置器
+
+#ifndef __SGI_STL_INTERNAL_NUMA_ALLOC_H
+#define __SGI_STL_INTERNAL_NUMA_ALLOC_H
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <string.h>
+#ifdef __linux__
+#  include <sys/syscall.h>
+#endif
+#ifdef __STL_PTHREADS
+#  include <pthread.h>
+#endif
+
+__STL_BEGIN_NAMESPACE
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma set woff 1174
+#endif
+
+enum { __hugepage_region = 2 * 1024 * 1024 };   // 区域大小, 也是对齐
+enum { __hugepage_align = 64 };                  // 小块的取整单位
+enum { __hugepage_max_small = 16 * 1024 };       // 小块的上限
+enum { __hugepage_max_nodes = 16 };              // 更大的结点号归入最后一个
+
+// 映射一块以align对齐的匿名内存, 失败时返回0
+// 多映射align字节, 再把两端多出的部分解除映射
+inline void* __hugepage_map(size_t n, size_t align)
+{
+  size_t page = size_t(sysconf(_SC_PAGESIZE));
+  n = (n + page - 1) & ~(page - 1);
+  size_t len = n + align;
+  char* p = (char*) mmap(0, len, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == (char*) MAP_FAILED)
+    return 0;
+  char* q = (char*) (((size_t) p + align - 1) & ~(align - 1));
+  if (q != p)
+    munmap(p, q - p);
+  if (p + len != q + n)
+    munmap(q + n, (p + len) - (q + n));
+#ifdef MADV_HUGEPAGE
+  madvise(q, n, MADV_HUGEPAGE);
+#endif
+  return q;
+}
+
+// 调用线程当前所在的NUMA结点
+inline int __numa_current_node()
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+  unsigned cpu = 0, node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, 0) == 0)
+    return node < unsigned(__hugepage_max_nodes) ? int(node)
+                                                 : __hugepage_max_nodes - 1;
+#endif
+  return 0;
+}
+
+// 把[p, p + n)绑定到结点node, 必须在第一次访问之前调用
+// 没有多个结点或者系统不支持时什么也不做
+inline void __numa_bind(void* p, size_t n, int node)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+  const int mpol_bind = 2;      // MPOL_BIND, 见<linux/mempolicy.h>
+  unsigned long mask = 1UL << node;
+  syscall(SYS_mbind, p, n, mpol_bind, &mask, sizeof(mask) * 8, 0);
+#endif
+}
+
+// bind_node为false时所有线程共用结点0的区域
+template <bool bind_node, int inst>
+class __hugepage_alloc_template
+{
+private:
+  struct obj { obj* next; };
+
+  struct node_arena {
+    char* cur;                  // 当前区域中未使用部分的起点
+    char* end;
+    obj* free_list[__hugepage_max_small / __hugepage_align];
+#ifdef __STL_PTHREADS
+    pthread_mutex_t lock;
+#endif
+  };
+
+  static node_arena arenas[__hugepage_max_nodes];
+
+  static size_t round_up(size_t n)
+  {
+    return (n + __hugepage_align - 1) & ~size_t(__hugepage_align - 1);
+  }
+
+  // 自由链表区块的大小; n == 0时也占一个最小的区块, 不能算出free_list[-1]
+  static size_t block_size(size_t n)
+  {
+    return n == 0 ? size_t(__hugepage_align) : round_up(n);
+  }
+
+  // 每个区域的开头记录它属于哪个结点, 释放时按地址找回
+  struct region_header { int node; };
+
+  static int region_node(void* p)
+  {
+    size_t base = (size_t) p & ~size_t(__hugepage_region - 1);
+    return ((region_header*) base)->node;
+  }
+
+  // 给结点node换一个新区域, 原区域剩下的尾部不再使用
+  static bool refill(node_arena& a, int node)
+  {
+    char* r = (char*) __hugepage_map(__hugepage_region, __hugepage_region);
+    if (!r)
+      return false;
+    if (bind_node)
+      __numa_bind(r, __hugepage_region, node);
+    ((region_header*) r)->node = node;
+    a.cur = r + round_up(sizeof(region_header));
+    a.end = r + __hugepage_region;
+    return true;
+  }
+
+#ifdef __STL_PTHREADS
+  struct lock_guard {
+    pthread_mutex_t* m;
+    lock_guard(pthread_mutex_t* x) : m(x) { pthread_mutex_lock(m); }
+    ~lock_guard() { pthread_mutex_unlock(m); }
+  };
+#endif
+
+public:
+  static void* allocate(size_t n)
+  {
+    if (n > __hugepage_max_small) {
+      void* p = __hugepage_map(n, __hugepage_region);
+      if (!p)
+        __THROW_BAD_ALLOC;
+      if (bind_node)
+        __numa_bind(p, n, __numa_current_node());
+      return p;
+    }
+
+    int node = bind_node ? __numa_current_node() : 0;
+    node_arena& a = arenas[node];
+    size_t sz = block_size(n);
+#ifdef __STL_PTHREADS
+    lock_guard guard(&a.lock);
+#endif
+    obj** list = a.free_list + (sz / __hugepage_align - 1);
+    if (*list) {
+      obj* result = *list;
+      *list = result->next;
+      return result;
+    }
+    if (size_t(a.end - a.cur) < sz && !refill(a, node))
+      __THROW_BAD_ALLOC;
+    void* result = a.cur;
+    a.cur += sz;
+    return result;
+  }
+
+  static void deallocate(void* p, size_t n)
+  {
+    if (n > __hugepage_max_small) {
+      munmap(p, n);             // 长度会被向上取整到页, 和__hugepage_map()一致
+      return;
+    }
+    // 放回分配它的结点, 而不是当前线程的结点
+    node_arena& a = arenas[region_node(p)];
+    size_t sz = block_size(n);
+#ifdef __STL_PTHREADS
+    lock_guard guard(&a.lock);
+#endif
+    obj** list = a.free_list + (sz / __hugepage_align - 1);
+    ((obj*) p)->next = *list;
+    *list = (obj*) p;
+  }
+
+  static void* reallocate(void* p, size_t old_sz, size_t new_sz)
+  {
+    void* result = allocate(new_sz);
+    memcpy(result, p, old_sz < new_sz ? old_sz : new_sz);
+    deallocate(p, old_sz);
+    return result;
+  }
+};
+
+// 静态数据成员的定义与初值, 区域在第一次分配时才建立
+#ifdef __STL_PTHREADS
+#  define __STL_HUGEPAGE_ARENA_INIT { 0, 0, { 0 }, PTHREAD_MUTEX_INITIALIZER }
+#else
+#  define __STL_HUGEPAGE_ARENA_INIT { 0, 0, { 0 } }
+#endif
+
+template <bool bind_node, int inst>
+typename __hugepage_alloc_template<bind_node, inst>::node_arena
+__hugepage_alloc_template<bind_node, inst>::arenas[__hugepage_max_nodes] = {
+  __STL_HUGEPAGE_ARENA_INIT, __STL_HUGEPAGE_ARENA_INIT,
+  __STL_HUGEPAGE_ARENA_INIT, __STL_HUGEPAGE_ARENA_INIT,
+  __STL_HUGEPAGE_ARENA_INIT, __STL_HUGEPAGE_ARENA_INIT,
+  __STL_HUGEPAGE_ARENA_INIT, __STL_HUGEPAGE_ARENA_INIT,
+  __STL_HUGEPAGE_ARENA_INIT, __STL_HUGEPAGE_ARENA_INIT,
+  __STL_HUGEPAGE_ARENA_INIT, __STL_HUGEPAGE_ARENA_INIT,
+  __STL_HUGEPAGE_ARENA_INIT, __STL_HUGEPAGE_ARENA_INIT,
+  __STL_HUGEPAGE_ARENA_INIT, __STL_HUGEPAGE_ARENA_INIT
+};
+
+#undef __STL_HUGEPAGE_ARENA_INIT
+
+typedef __hugepage_alloc_template<false, 0> hugepage_alloc;
+typedef __hugepage_alloc_template<true, 0> numa_alloc;
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma reset woff 1174
+#endif
+
+__STL_END_NAMESPACE
+
+#endif /* __SGI_STL_INTERNAL_NUMA_ALLOC_H */
+
+// Local Variables:
+// mode:C++
+// End:
@@ -0,0 +1,116 @@
+// Filename:    stl_parallel.h
+// 容器并行算法共用的线程工具
+// 只有在<stl_config.h>中定义了__STL_PTHREADS时才可用
+#ifndef __SGI_STL_INTERNAL_PARALLEL_H
+#define __SGI_STL_INTERNAL_PARALLEL_H
+
+#ifdef __STL_PTHREADS
+
+#include <pthread.h>
+#include <unistd.h>
+
+__STL_BEGIN_NAMESPACE
+
+// 默认的线程数: 在线的CPU个数
+inline size_t __parallel_default_threads()
+{
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? size_t(n) : size_t(1);
+}
+
+template <class Function>
+struct __parallel_task
+{
+  Function* f;
+  size_t index;
+  pthread_t thread;
+};
+
+template <class Function>
+void* __parallel_entry(void* arg)
+{
+  __parallel_task<Function>* task = (__parallel_task<Function>*) arg;
+  (*task->f)(task->index);
+  return 0;
+}
+
+// 对i = 0 .. n - 1各调用一次f(i), 全部完成后才返回
+// f(0)在调用者线程上执行, 其余每份一个线程;
+// 如果线程创建失败, 剩下的份数退回到调用者线程上顺序执行
+// 注意: f不能抛出异常, 工作线程中的异常无法传回调用者
+template <class Function>
+void __parallel_run(size_t n, Function& f)
+{
+  typedef __parallel_task<Function> task_type;
+  typedef simple_alloc<task_type, alloc> task_allocator;
+
+  if (n == 0)
+    return;
+  if (n == 1) {
+    f(0);
+    return;
+  }
+
+  task_type* tasks = task_allocator::allocate(n);
+  size_t started = 1;
+  for ( ; started < n; ++started) {
+    tasks[started].f = &f;
+    tasks[started].index = started;
+    if (pthread_create(&tasks[started].thread, 0,
+                       __parallel_entry<Function>, &tasks[started]) != 0)
+      break;
+  }
+
+  f(0);
+  for (size_t i = started; i < n; ++i)
+    f(i);
+
+  for (size_t i = 1; i < started; ++i)
+    pthread_join(tasks[i].thread, 0);
+  task_allocator::deallocate(tasks, n);
+}
+
+// 按批动态分配任务: 工作线程做完一批再来取下一批, 先做完的自然多拿,
+// 元素代价不均匀时比事先平均切分更能让所有线程同时结束
+// stop(b)之后编号不小于b的批次不再分出, 用于find_if这类可以提前结束的算法
+class __parallel_batches
+{
+public:
+  __parallel_batches(size_t n) : next_batch(0), limit(n)
+  {
+    pthread_mutex_init(&lock, 0);
+  }
+  ~__parallel_batches() { pthread_mutex_destroy(&lock); }
+
+  bool next(size_t& b)
+  {
+    pthread_mutex_lock(&lock);
+    bool ok = next_batch < limit;
+    if (ok)
+      b = next_batch++;
+    pthread_mutex_unlock(&lock);
+    return ok;
+  }
+
+  void stop(size_t b)
+  {
+    pthread_mutex_lock(&lock);
+    if (b < limit)
+      limit = b;
+    pthread_mutex_unlock(&lock);
+  }
+
+private:
+  pthread_mutex_t lock;
+  size_t next_batch;
+  size_t limit;
+
+  __parallel_batches(const __parallel_batches&);
+  void operator=(const __parallel_batches&);
+};
+
+__STL_END_NAMESPACE
+
+#endif /* __STL_PTHREADS */
+
+#endif /* __SGI_STL_INTERNAL_PARALLEL_H */
@@ -0,0 +1,354 @@
+// Filename:    stl_pthread_alloc.h
+// 每个线程带有缓存的小对象配置器
+//
+// SGI默认的alloc只有一个内存池, 多线程时每次分配和释放都要抢同一把锁
+// pthread_alloc的接口和alloc相同, 用作容器的Alloc参数, 例如
+// slist<T, pthread_alloc>, deque<T, pthread_alloc>
+//
+// 结构:
+//   大小类别    不超过128字节的请求按8字节取整, 和alloc一样(但至少两个指针大);
+//              129 ~ 4096字节取整到2的幂, 以便容纳deque的缓冲区;
+//              超过4096字节的请求直接交给malloc_alloc
+//   线程缓存    每个线程对每个类别有一条自由链表, 分配和释放都不加锁
+//   中央池      每个类别一把锁, 以"批"为单位和线程缓存交换区块:
+//              线程缓存为空时取回一批, 超过两批时归还一批;
+//              中央池也空了才从大块内存中切出新的一批
+//   线程退出时, 它缓存的区块全部还给中央池, 可以被其他线程使用;
+//   和alloc一样, 内存从不归还给系统
+//
+// 没有定义__STL_PTHREADS时只有一个线程缓存, 不加锁
+
+#ifndef __SGI_STL_INTERNAL_PTHREAD_ALLOC_H
+#define __SGI_STL_INTERNAL_PTHREAD_ALLOC_H
+
+#include <string.h>
+#ifdef __STL_PTHREADS
+#  include <pthread.h>
+#endif
+
+__STL_BEGIN_NAMESPACE
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma set woff 1174
+#endif
+
+enum { __pthread_alloc_small = 128 };           // 按8字节取整的上限
+enum { __pthread_alloc_max_bytes = 4096 };      // 更大的请求交给malloc_alloc
+enum { __pthread_alloc_classes = 16 + 5 };      // 8, 16, ..., 128, 256, ..., 4096
+enum { __pthread_alloc_chunk = 64 * 1024 };     // 每次从malloc_alloc取的大块
+
+template <int inst>
+class __pthread_alloc_template
+{
+private:
+  // 空闲区块; 中央池中每一批的第一个区块用next_batch串起各批,
+  // 所以小于sizeof(obj)的请求按sizeof(obj)分配
+  struct obj {
+    obj* next;
+    obj* next_batch;
+  };
+
+  struct thread_cache {
+    obj* list[__pthread_alloc_classes];
+    size_t count[__pthread_alloc_classes];
+  };
+
+  struct central_list {
+    obj* batches;               // 整批的区块, 每批batch_count()个
+    obj* loose;                 // 线程退出时还回来的零散区块
+#ifdef __STL_PTHREADS
+    pthread_mutex_t lock;
+#endif
+  };
+
+  static central_list central[__pthread_alloc_classes];
+  static char* chunk_cur;       // 切分新区块用的大块内存
+  static char* chunk_end;
+
+#ifdef __STL_PTHREADS
+  static pthread_mutex_t chunk_lock;
+  static pthread_key_t key;
+  static pthread_once_t key_once;
+
+  struct lock_guard {
+    pthread_mutex_t* m;
+    lock_guard(pthread_mutex_t* x) : m(x) { pthread_mutex_lock(m); }
+    ~lock_guard() { pthread_mutex_unlock(m); }
+  };
+#else /* __STL_PTHREADS */
+  static thread_cache single_cache;
+#endif /* __STL_PTHREADS */
+
+  static size_t class_index(size_t n)
+  {
+    if (n < sizeof(obj))
+      n = sizeof(obj);
+    if (n <= __pthread_alloc_small)
+      return (n + 7) / 8 - 1;
+    size_t i = 16;
+    for (size_t sz = 256; sz < n; sz <<= 1)
+      ++i;
+    return i;
+  }
+
+  static size_t class_size(size_t i)
+  {
+    return i < 16 ? (i + 1) * 8 : size_t(256) << (i - 16);
+  }
+
+  // 一批的区块个数: 一批大约8KB, 至少4个, 至多64个
+  static size_t batch_count(size_t i)
+  {
+    size_t n = 8192 / class_size(i);
+    return n < 4 ? 4 : (n > 64 ? 64 : n);
+  }
+
+  static thread_cache* get_cache();
+  static obj* refill(thread_cache* tc, size_t i);
+  static void release_batch(thread_cache* tc, size_t i);
+  static obj* carve(size_t i, size_t n);
+
+#ifdef __STL_PTHREADS
+  static void make_key() { pthread_key_create(&key, thread_exit); }
+  static void thread_exit(void* p);
+#endif
+
+public:
+  static void* allocate(size_t n)
+  {
+    if (n > __pthread_alloc_max_bytes)
+      return malloc_alloc::allocate(n);
+    size_t i = class_index(n);
+    thread_cache* tc = get_cache();
+    obj* result = tc->list[i];
+    if (result == 0)
+      return refill(tc, i);
+    tc->list[i] = result->next;
+    --tc->count[i];
+    return result;
+  }
+
+  static void deallocate(void* p, size_t n)
+  {
+    if (n > __pthread_alloc_max_bytes) {
+      malloc_alloc::deallocate(p, n);
+      return;
+    }
+    size_t i = class_index(n);
+    thread_cache* tc = get_cache();
+    obj* q = (obj*) p;
+    q->next = tc->list[i];
+    tc->list[i] = q;
+    if (++tc->count[i] > 2 * batch_count(i))
+      release_batch(tc, i);
+  }
+
+  static void* reallocate(void* p, size_t old_sz, size_t new_sz)
+  {
+    if (old_sz > __pthread_alloc_max_bytes && new_sz > __pthread_alloc_max_bytes)
+      return malloc_alloc::reallocate(p, old_sz, new_sz);
+    if (old_sz <= __pthread_alloc_max_bytes && new_sz <= __pthread_alloc_max_bytes
+        && class_index(old_sz) == class_index(new_sz))
+      return p;
+    void* result = allocate(new_sz);
+    memcpy(result, p, old_sz < new_sz ? old_sz : new_sz);
+    deallocate(p, old_sz);
+    return result;
+  }
+};
+
+#ifdef __STL_PTHREADS
+
+template <int inst>
+typename __pthread_alloc_template<inst>::thread_cache*
+__pthread_alloc_template<inst>::get_cache()
+{
+  pthread_once(&key_once, make_key);
+  thread_cache* tc = (thread_cache*) pthread_getspecific(key);
+  if (tc == 0) {
+    tc = (thread_cache*) malloc_alloc::allocate(sizeof(thread_cache));
+    for (size_t i = 0; i < __pthread_alloc_classes; ++i) {
+      tc->list[i] = 0;
+      tc->count[i] = 0;
+    }
+    pthread_setspecific(key, tc);
+  }
+  return tc;
+}
+
+// 线程退出: 每个类别的区块整串挂到中央池的零散链表上
+template <int inst>
+void __pthread_alloc_template<inst>::thread_exit(void* p)
+{
+  thread_cache* tc = (thread_cache*) p;
+  for (size_t i = 0; i < __pthread_alloc_classes; ++i) {
+    obj* first = tc->list[i];
+    if (first == 0)
+      continue;
+    obj* last = first;
+    while (last->next)
+      last = last->next;
+    lock_guard guard(&central[i].lock);
+    last->next = central[i].loose;
+    central[i].loose = first;
+  }
+  malloc_alloc::deallocate(tc, sizeof(thread_cache));
+}
+
+#else /* __STL_PTHREADS */
+
+template <int inst>
+inline typename __pthread_alloc_template<inst>::thread_cache*
+__pthread_alloc_template<inst>::get_cache()
+{
+  return &single_cache;
+}
+
+#endif /* __STL_PTHREADS */
+
+// 从大块内存中切出n个类别i的区块, 串成一条链
+// 大块剩下的尾部放不下一个区块时直接丢弃
+template <int inst>
+typename __pthread_alloc_template<inst>::obj*
+__pthread_alloc_template<inst>::carve(size_t i, size_t n)
+{
+  size_t sz = class_size(i);
+  char* p;
+  {
+#ifdef __STL_PTHREADS
+    lock_guard guard(&chunk_lock);
+#endif
+    if (size_t(chunk_end - chunk_cur) < n * sz) {
+      chunk_cur = (char*) malloc_alloc::allocate(__pthread_alloc_chunk);
+      chunk_end = chunk_cur + __pthread_alloc_chunk;
+    }
+    p = chunk_cur;
+    chunk_cur += n * sz;
+  }
+  for (size_t k = 0; k + 1 < n; ++k)
+    ((obj*) (p + k * sz))->next = (obj*) (p + (k + 1) * sz);
+  ((obj*) (p + (n - 1) * sz))->next = 0;
+  return (obj*) p;
+}
+
+// 线程缓存的类别i用完了: 从中央池取一批, 返回其中一个, 其余放进缓存
+template <int inst>
+typename __pthread_alloc_template<inst>::obj*
+__pthread_alloc_template<inst>::refill(thread_cache* tc, size_t i)
+{
+  size_t n = batch_count(i);
+  obj* chain = 0;
+  size_t got = 0;
+  {
+    central_list& c = central[i];
+#ifdef __STL_PTHREADS
+    lock_guard guard(&c.lock);
+#endif
+    if (c.batches) {
+      chain = c.batches;
+      c.batches = chain->next_batch;
+      got = n;
+    }
+    else if (c.loose) {
+      chain = c.loose;
+      obj* last = chain;
+      for (got = 1; got < n && last->next; ++got)
+        last = last->next;
+      c.loose = last->next;
+      last->next = 0;
+    }
+  }
+  if (chain == 0) {
+    chain = carve(i, n);
+    got = n;
+  }
+  tc->list[i] = chain->next;
+  tc->count[i] = got - 1;
+  return chain;
+}
+
+// 线程缓存的类别i超过两批: 把前面的一批整体还给中央池
+template <int inst>
+void __pthread_alloc_template<inst>::release_batch(thread_cache* tc, size_t i)
+{
+  size_t n = batch_count(i);
+  obj* first = tc->list[i];
+  obj* last = first;
+  for (size_t k = 1; k < n; ++k)
+    last = last->next;
+  tc->list[i] = last->next;
+  tc->count[i] -= n;
+  last->next = 0;
+
+  central_list& c = central[i];
+#ifdef __STL_PTHREADS
+  lock_guard guard(&c.lock);
+#endif
+  first->next_batch = c.batches;
+  c.batches = first;
+}
+
+// 静态数据成员的定义与初值
+#ifdef __STL_PTHREADS
+#  define __STL_PTHREAD_ALLOC_CENTRAL_INIT { 0, 0, PTHREAD_MUTEX_INITIALIZER }
+#else
+#  define __STL_PTHREAD_ALLOC_CENTRAL_INIT { 0, 0 }
+#endif
+
+template <int inst>
+typename __pthread_alloc_template<inst>::central_list
+__pthread_alloc_template<inst>::central[__pthread_alloc_classes] = {
+  __STL_PTHREAD_ALLOC_CENTRAL_INIT, __STL_PTHREAD_ALLOC_CENTRAL_INIT,
+  __STL_PTHREAD_ALLOC_CENTRAL_INIT, __STL_PTHREAD_ALLOC_CENTRAL_INIT,
+  __STL_PTHREAD_ALLOC_CENTRAL_INIT, __STL_PTHREAD_ALLOC_CENTRAL_INIT,
+  __STL_PTHREAD_ALLOC_CENTRAL_INIT, __STL_PTHREAD_ALLOC_CENTRAL_INIT,
+  __STL_PTHREAD_ALLOC_CENTRAL_INIT, __STL_PTHREAD_ALLOC_CENTRAL_INIT,
+  __STL_PTHREAD_ALLOC_CENTRAL_INIT, __STL_PTHREAD_ALLOC_CENTRAL_INIT,
+  __STL_PTHREAD_ALLOC_CENTRAL_INIT, __STL_PTHREAD_ALLOC_CENTRAL_INIT,
+  __STL_PTHREAD_ALLOC_CENTRAL_INIT, __STL_PTHREAD_ALLOC_CENTRAL_INIT,
+  __STL_PTHREAD_ALLOC_CENTRAL_INIT, __STL_PTHREAD_ALLOC_CENTRAL_INIT,
+  __STL_PTHREAD_ALLOC_CENTRAL_INIT, __STL_PTHREAD_ALLOC_CENTRAL_INIT,
+  __STL_PTHREAD_ALLOC_CENTRAL_INIT
+};
+
+#undef __STL_PTHREAD_ALLOC_CENTRAL_INIT
+
+template <int inst>
+char* __pthread_alloc_template<inst>::chunk_cur = 0;
+
+template <int inst>
+char* __pthread_alloc_template<inst>::chunk_end = 0;
+
+#ifdef __STL_PTHREADS
+
+template <int inst>
+pthread_mutex_t __pthread_alloc_template<inst>::chunk_lock
+  = PTHREAD_MUTEX_INITIALIZER;
+
+template <int inst>
+pthread_key_t __pthread_alloc_template<inst>::key;
+
+template <int inst>
+pthread_once_t __pthread_alloc_template<inst>::key_once = PTHREAD_ONCE_INIT;
+
+#else /* __STL_PTHREADS */
+
+template <int inst>
+typename __pthread_alloc_template<inst>::thread_cache
+__pthread_alloc_template<inst>::single_cache;
+
+#endif /* __STL_PTHREADS */
+
+typedef __pthread_alloc_template<0> pthread_alloc;
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma reset woff 1174
+#endif
+
+__STL_END_NAMESPACE
+
+#endif /* __SGI_STL_INTERNAL_PTHREAD_ALLOC_H */
+
+// Local Variables:
+// mode:C++
+// End:
@@ -43,6 +43,21 @@ public:
 	const_reference back() const { return c.back(); }
 	void push(const value_type& x) { c.push_back(x); }
 	void pop() { c.pop_front(); }
+
+	// 批量出队min(n, size())个元素, 依次写入out, 返回写入后的out
+	// 要求底层容器提供pop_front_n(), 见<stl_deque.h>
+#ifdef __STL_MEMBER_TEMPLATES
+	template <class OutputIterator>
+	OutputIterator pop_n(size_type n, OutputIterator out)
+	{
+		return c.pop_front_n(n, out);
+	}
+#else /* __STL_MEMBER_TEMPLATES */
+	value_type* pop_n(size_type n, value_type* out)
+	{
+		return c.pop_front_n(n, out);
+	}
+#endif /* __STL_MEMBER_TEMPLATES */
 };
 
 // 详细讲解见<stl_pair.h>
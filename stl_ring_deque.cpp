@@ -0,0 +1,459 @@
+// Filename:    stl_ring_deque.h
+// 环形缓冲区: 容量固定(或按需加倍)的deque
+//
+// queue<T, deque<T> >即使最大深度已知, 每次访问元素也要经过map间接寻址,
+// 队列前进时还要不断分配和释放缓冲区
+// ring_deque<T, N>把所有元素放在一块连续的内存中, 容量是2的幂,
+// 第i个元素在buf[(head + i) & mask], 下标只需一次与运算
+//
+// 提供queue/deque常用的接口: push_back(), push_front(), pop_front(),
+// pop_back(), front(), back(), operator[], 随机存取迭代器, 比较运算符,
+// 可以直接作为queue的底层容器: queue<T, ring_deque<T, 64> >
+// 不提供在中间插入或删除元素
+//
+// 容量: 默认构造时为N向上取整到2的幂(N为0时第一次插入才分配),
+//       运行时可以用reserve()扩大
+// 容器已满时push_back()/push_front()的行为由溢出策略决定:
+//   ring_grow        容量加倍, 和deque一样不丢失元素(默认)
+//   ring_reject      不插入, 返回false
+//   ring_overwrite   覆盖另一端最旧的元素, push_back()覆盖front(),
+//                    push_front()覆盖back()
+// 插入成功时push_back()/push_front()返回true
+// 只有已满时才检查策略, 不影响一般情况的速度
+// 注意: 加倍或覆盖之后原有的迭代器都失效
+
+#ifndef __SGI_STL_INTERNAL_RING_DEQUE_H
+#define __SGI_STL_INTERNAL_RING_DEQUE_H
+
+__STL_BEGIN_NAMESPACE
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma set woff 1174
+#endif
+
+enum ring_overflow { ring_grow, ring_reject, ring_overwrite };
+
+// 不小于n的最小的2的幂, n为0时返回0
+inline size_t __ring_round_up(size_t n)
+{
+  if (n == 0)
+    return 0;
+  size_t result = 1;
+  while (result < n)
+    result <<= 1;
+  return result;
+}
+
+// index是不取模的逻辑位置, 从容器的head开始递增, 解引用时才取模,
+// 所以end()和begin()不会重合, 迭代器可以直接比较大小
+template <class T, class Ref, class Ptr>
+struct __ring_deque_iterator {
+  typedef __ring_deque_iterator<T, T&, T*>             iterator;
+  typedef __ring_deque_iterator<T, const T&, const T*> const_iterator;
+
+  typedef random_access_iterator_tag iterator_category;
+  typedef T value_type;
+  typedef Ptr pointer;
+  typedef Ref reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  typedef __ring_deque_iterator self;
+
+  T* buf;
+  size_t mask;
+  size_t index;
+
+  __ring_deque_iterator(T* b, size_t m, size_t i)
+    : buf(b), mask(m), index(i) {}
+  __ring_deque_iterator() : buf(0), mask(0), index(0) {}
+  __ring_deque_iterator(const iterator& x)
+    : buf(x.buf), mask(x.mask), index(x.index) {}
+
+  reference operator*() const { return buf[index & mask]; }
+
+#ifndef __SGI_STL_NO_ARROW_OPERATOR
+  pointer operator->() const { return &(operator*()); }
+#endif /* __SGI_STL_NO_ARROW_OPERATOR */
+
+  difference_type operator-(const self& x) const
+  {
+    return difference_type(index - x.index);
+  }
+
+  self& operator++() { ++index; return *this; }
+  self operator++(int) { self tmp = *this; ++index; return tmp; }
+  self& operator--() { --index; return *this; }
+  self operator--(int) { self tmp = *this; --index; return tmp; }
+
+  self& operator+=(difference_type n) { index += n; return *this; }
+  self operator+(difference_type n) const { self tmp = *this; return tmp += n; }
+  self& operator-=(difference_type n) { index -= n; return *this; }
+  self operator-(difference_type n) const { self tmp = *this; return tmp -= n; }
+
+  reference operator[](difference_type n) const { return *(*this + n); }
+
+  bool operator==(const self& x) const { return index == x.index; }
+  bool operator!=(const self& x) const { return index != x.index; }
+  bool operator<(const self& x) const
+  {
+    return difference_type(index - x.index) < 0;
+  }
+};
+
+#ifndef __STL_CLASS_PARTIAL_SPECIALIZATION
+
+template <class T, class Ref, class Ptr>
+inline random_access_iterator_tag
+iterator_category(const __ring_deque_iterator<T, Ref, Ptr>&) {
+  return random_access_iterator_tag();
+}
+
+template <class T, class Ref, class Ptr>
+inline T* value_type(const __ring_deque_iterator<T, Ref, Ptr>&) {
+  return 0;
+}
+
+template <class T, class Ref, class Ptr>
+inline ptrdiff_t* distance_type(const __ring_deque_iterator<T, Ref, Ptr>&) {
+  return 0;
+}
+
+#endif /* __STL_CLASS_PARTIAL_SPECIALIZATION */
+
+template <class T, size_t N = 0, class Alloc = alloc>
+class ring_deque
+{
+public:
+  typedef T value_type;
+  typedef value_type* pointer;
+  typedef const value_type* const_pointer;
+  typedef value_type& reference;
+  typedef const value_type& const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  typedef __ring_deque_iterator<T, T&, T*>             iterator;
+  typedef __ring_deque_iterator<T, const T&, const T*> const_iterator;
+
+#ifdef __STL_CLASS_PARTIAL_SPECIALIZATION
+  typedef reverse_iterator<const_iterator> const_reverse_iterator;
+  typedef reverse_iterator<iterator> reverse_iterator;
+#else /* __STL_CLASS_PARTIAL_SPECIALIZATION */
+  typedef reverse_iterator<const_iterator, value_type, const_reference,
+                           difference_type>
+          const_reverse_iterator;
+  typedef reverse_iterator<iterator, value_type, reference, difference_type>
+          reverse_iterator;
+#endif /* __STL_CLASS_PARTIAL_SPECIALIZATION */
+
+protected:
+  typedef simple_alloc<value_type, Alloc> data_allocator;
+
+  T* buf;
+  size_type mask;               // 容量 - 1, 没有缓冲区时为size_type(-1)
+  size_type head;               // front()在buf中的位置
+  size_type count;
+  ring_overflow policy;
+
+public:
+  iterator begin() { return iterator(buf, mask, head); }
+  iterator end() { return iterator(buf, mask, head + count); }
+  const_iterator begin() const { return const_iterator(buf, mask, head); }
+  const_iterator end() const
+  {
+    return const_iterator(buf, mask, head + count);
+  }
+
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const
+  {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const
+  {
+    return const_reverse_iterator(begin());
+  }
+
+  reference operator[](size_type n) { return buf[(head + n) & mask]; }
+  const_reference operator[](size_type n) const
+  {
+    return buf[(head + n) & mask];
+  }
+
+  reference front() { return buf[head]; }
+  reference back() { return buf[(head + count - 1) & mask]; }
+  const_reference front() const { return buf[head]; }
+  const_reference back() const { return buf[(head + count - 1) & mask]; }
+
+  size_type size() const { return count; }
+  size_type max_size() const { return size_type(-1) / sizeof(T); }
+  size_type capacity() const { return mask + 1; }
+  bool empty() const { return count == 0; }
+  bool full() const { return count == mask + 1; }
+
+  ring_overflow overflow_policy() const { return policy; }
+  void set_overflow_policy(ring_overflow p) { policy = p; }
+
+public:
+  explicit ring_deque(ring_overflow p = ring_grow)
+    : buf(0), mask(size_type(-1)), head(0), count(0), policy(p)
+  {
+    reserve(N);
+  }
+
+  ring_deque(size_type n, const value_type& value)
+    : buf(0), mask(size_type(-1)), head(0), count(0), policy(ring_grow)
+  {
+    fill_initialize(n, value);
+  }
+
+  ring_deque(int n, const value_type& value)
+    : buf(0), mask(size_type(-1)), head(0), count(0), policy(ring_grow)
+  {
+    fill_initialize(n, value);
+  }
+
+  ring_deque(long n, const value_type& value)
+    : buf(0), mask(size_type(-1)), head(0), count(0), policy(ring_grow)
+  {
+    fill_initialize(n, value);
+  }
+
+  explicit ring_deque(size_type n)
+    : buf(0), mask(size_type(-1)), head(0), count(0), policy(ring_grow)
+  {
+    fill_initialize(n, value_type());
+  }
+
+  // 容量和策略都和x相同
+  ring_deque(const ring_deque& x)
+    : buf(0), mask(size_type(-1)), head(0), count(0), policy(x.policy)
+  {
+    reserve(x.capacity());
+    __STL_TRY {
+      uninitialized_copy(x.begin(), x.end(), buf);
+      count = x.count;
+    }
+    __STL_UNWIND(deallocate_buffer());
+  }
+
+#ifdef __STL_MEMBER_TEMPLATES
+
+  template <class InputIterator>
+  ring_deque(InputIterator first, InputIterator last)
+    : buf(0), mask(size_type(-1)), head(0), count(0), policy(ring_grow)
+  {
+    reserve(N);
+    __STL_TRY {
+      for ( ; first != last; ++first)
+        push_back(*first);
+    }
+    __STL_UNWIND(clear(); deallocate_buffer());
+  }
+
+#else /* __STL_MEMBER_TEMPLATES */
+
+  ring_deque(const value_type* first, const value_type* last)
+    : buf(0), mask(size_type(-1)), head(0), count(0), policy(ring_grow)
+  {
+    reserve(N > size_type(last - first) ? N : size_type(last - first));
+    __STL_TRY {
+      uninitialized_copy(first, last, buf);
+      count = last - first;
+    }
+    __STL_UNWIND(deallocate_buffer());
+  }
+
+#endif /* __STL_MEMBER_TEMPLATES */
+
+  ~ring_deque()
+  {
+    clear();
+    deallocate_buffer();
+  }
+
+  ring_deque& operator=(const ring_deque& x)
+  {
+    if (&x != this) {
+      ring_deque tmp(x);
+      swap(tmp);
+    }
+    return *this;
+  }
+
+  void swap(ring_deque& x)
+  {
+    __STD::swap(buf, x.buf);
+    __STD::swap(mask, x.mask);
+    __STD::swap(head, x.head);
+    __STD::swap(count, x.count);
+    __STD::swap(policy, x.policy);
+  }
+
+public:
+  // 已满时交给push_back_aux()/push_front_aux()
+  bool push_back(const value_type& t)
+  {
+    if (count == mask + 1)
+      return push_back_aux(t);
+    construct(buf + ((head + count) & mask), t);
+    ++count;
+    return true;
+  }
+
+  bool push_front(const value_type& t)
+  {
+    if (count == mask + 1)
+      return push_front_aux(t);
+    size_type h = (head - 1) & mask;
+    construct(buf + h, t);
+    head = h;
+    ++count;
+    return true;
+  }
+
+  void pop_front()
+  {
+    destroy(buf + head);
+    head = (head + 1) & mask;
+    --count;
+  }
+
+  void pop_back()
+  {
+    --count;
+    destroy(buf + ((head + count) & mask));
+  }
+
+  void clear()
+  {
+    destroy(begin(), end());
+    head = 0;
+    count = 0;
+  }
+
+  // 把容量扩大到至少n(取整到2的幂), 不会缩小; 所有迭代器失效
+  void reserve(size_type n)
+  {
+    if (n > capacity())
+      reallocate(__ring_round_up(n));
+  }
+
+protected:
+  // 容器已满时的push
+  // ring_grow会释放旧缓冲区, t可能正是其中的元素(例如push_back(front())),
+  // 所以先复制一份, 和deque::push_back_aux()一样
+  bool push_back_aux(const value_type& t)
+  {
+    value_type t_copy = t;
+    if (!make_room())
+      return false;
+    if (count == mask + 1) {                    // ring_overwrite
+      buf[head] = t_copy;
+      head = (head + 1) & mask;
+      return true;
+    }
+    construct(buf + ((head + count) & mask), t_copy);
+    ++count;
+    return true;
+  }
+
+  bool push_front_aux(const value_type& t)
+  {
+    value_type t_copy = t;
+    if (!make_room())
+      return false;
+    size_type h = (head - 1) & mask;
+    if (count == mask + 1) {                    // ring_overwrite
+      buf[h] = t_copy;
+      head = h;
+      return true;
+    }
+    construct(buf + h, t_copy);
+    head = h;
+    ++count;
+    return true;
+  }
+
+  // 容器已满: ring_grow时加倍容量;
+  // ring_overwrite并且有缓冲区时返回true, 但不腾出位置, 由调用者覆盖
+  bool make_room()
+  {
+    if (policy == ring_grow) {
+      reallocate(buf ? 2 * capacity() : 8);
+      return true;
+    }
+    return policy == ring_overwrite && buf != 0;
+  }
+
+  // 换成容量为n的缓冲区, 元素从位置0开始连续存放
+  void reallocate(size_type n)
+  {
+    T* new_buf = data_allocator::allocate(n);
+    __STL_TRY {
+      uninitialized_copy(begin(), end(), new_buf);
+    }
+    __STL_UNWIND(data_allocator::deallocate(new_buf, n));
+    destroy(begin(), end());
+    deallocate_buffer();
+    buf = new_buf;
+    mask = n - 1;
+    head = 0;
+  }
+
+  void deallocate_buffer()
+  {
+    if (buf)
+      data_allocator::deallocate(buf, mask + 1);
+    buf = 0;
+    mask = size_type(-1);
+  }
+
+  void fill_initialize(size_type n, const value_type& value)
+  {
+    reserve(N > n ? N : n);
+    __STL_TRY {
+      uninitialized_fill_n(buf, n, value);
+      count = n;
+    }
+    __STL_UNWIND(deallocate_buffer());
+  }
+};
+
+template <class T, size_t N, class Alloc>
+inline bool operator==(const ring_deque<T, N, Alloc>& x,
+                       const ring_deque<T, N, Alloc>& y)
+{
+  return x.size() == y.size() && equal(x.begin(), x.end(), y.begin());
+}
+
+template <class T, size_t N, class Alloc>
+inline bool operator<(const ring_deque<T, N, Alloc>& x,
+                      const ring_deque<T, N, Alloc>& y)
+{
+  return lexicographical_compare(x.begin(), x.end(), y.begin(), y.end());
+}
+
+#ifdef __STL_FUNCTION_TMPL_PARTIAL_ORDER
+
+template <class T, size_t N, class Alloc>
+inline void swap(ring_deque<T, N, Alloc>& x, ring_deque<T, N, Alloc>& y)
+{
+  x.swap(y);
+}
+
+#endif /* __STL_FUNCTION_TMPL_PARTIAL_ORDER */
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma reset woff 1174
+#endif
+
+__STL_END_NAMESPACE
+
+#endif /* __SGI_STL_INTERNAL_RING_DEQUE_H */
+
+// Local Variables:
+// mode:C++
+// End:
@@ -0,0 +1,237 @@
+// Filename:    stl_simd_compare.h
+// 连续数组的比较内核: 找出两个数组第一个不相等的位置
+//
+// __simd_mismatch(a, b, n)返回第一个!(a[i] == b[i])的下标, 全部相等时返回n
+// deque的equal()/lexicographical_compare()按缓冲区分段后对每段调用它
+// (见<stl_deque.h>), 其他连续存放元素的容器也可以使用
+//
+// 通用版本逐个元素用operator==比较; 算术类型有专门的版本,
+// 并且__simd_comparable<T>::type是__true_type:
+//   整数, 字符, bool    按位相等就是相等, 按字节比较, 再换算成元素下标
+//   float, double       用浮点比较指令, 和operator==的结果一样
+//                       (NaN与任何值都不相等, +0.0 == -0.0)
+// 在x86-64上用GCC/Clang编译时, 运行时检测CPU:
+// 支持AVX2时一次比较32字节, 否则用SSE2一次比较16字节;
+// 其他平台上是按机器字比较的标量版本
+
+#ifndef __SGI_STL_INTERNAL_SIMD_COMPARE_H
+#define __SGI_STL_INTERNAL_SIMD_COMPARE_H
+
+#include <string.h>
+#if defined(__x86_64__) && defined(__GNUC__)
+#  define __STL_SIMD_X86_64
+#  include <immintrin.h>
+#endif
+
+__STL_BEGIN_NAMESPACE
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma set woff 1174
+#endif
+
+// 有专门比较内核的类型, 它们的operator==和operator<的等价关系一致
+// (NaN除外, 调用者要处理), 可以先找不相等的位置再用operator<比较
+template <class T>
+struct __simd_comparable
+{
+  typedef __false_type type;
+};
+
+__STL_TEMPLATE_NULL struct __simd_comparable<float>
+{
+  typedef __true_type type;
+};
+
+__STL_TEMPLATE_NULL struct __simd_comparable<double>
+{
+  typedef __true_type type;
+};
+
+template <class T>
+inline size_t __simd_mismatch(const T* a, const T* b, size_t n)
+{
+  size_t i = 0;
+  while (i < n && a[i] == b[i])
+    ++i;
+  return i;
+}
+
+// 标量版本: 按机器字比较, 不相等时再找出是哪个字节
+inline size_t __mismatch_bytes_scalar(const char* a, const char* b, size_t n)
+{
+  size_t i = 0;
+  for ( ; i + sizeof(unsigned long) <= n; i += sizeof(unsigned long)) {
+    unsigned long x, y;
+    memcpy(&x, a + i, sizeof(x));
+    memcpy(&y, b + i, sizeof(y));
+    if (x != y)
+      break;
+  }
+  while (i < n && a[i] == b[i])
+    ++i;
+  return i;
+}
+
+#ifdef __STL_SIMD_X86_64
+
+inline bool __simd_has_avx2()
+{
+  static const bool result = (__builtin_cpu_init(),
+                              __builtin_cpu_supports("avx2") != 0);
+  return result;
+}
+
+// SSE2是x86-64的基本指令集, 不需要检测
+inline size_t __mismatch_bytes_sse2(const char* a, const char* b, size_t n)
+{
+  size_t i = 0;
+  for ( ; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i*) (a + i));
+    __m128i y = _mm_loadu_si128((const __m128i*) (b + i));
+    unsigned mask = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)));
+    if (mask != 0xffff)
+      return i + __builtin_ctz(~mask);
+  }
+  return i + __mismatch_bytes_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+inline size_t __mismatch_bytes_avx2(const char* a, const char* b, size_t n)
+{
+  size_t i = 0;
+  for ( ; i + 32 <= n; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i*) (a + i));
+    __m256i y = _mm256_loadu_si256((const __m256i*) (b + i));
+    unsigned mask = unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)));
+    if (mask != 0xffffffffu)
+      return i + __builtin_ctz(~mask);
+  }
+  return i + __mismatch_bytes_sse2(a + i, b + i, n - i);
+}
+
+inline size_t __mismatch_float_sse2(const float* a, const float* b, size_t n)
+{
+  size_t i = 0;
+  for ( ; i + 4 <= n; i += 4) {
+    int mask = _mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(a + i),
+                                            _mm_loadu_ps(b + i)));
+    if (mask != 0xf)
+      return i + __builtin_ctz(~mask);
+  }
+  return i + __simd_mismatch<float>(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+inline size_t __mismatch_float_avx2(const float* a, const float* b, size_t n)
+{
+  size_t i = 0;
+  for ( ; i + 8 <= n; i += 8) {
+    int mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(a + i),
+                                                _mm256_loadu_ps(b + i),
+                                                _CMP_EQ_OQ));
+    if (mask != 0xff)
+      return i + __builtin_ctz(~mask);
+  }
+  return i + __mismatch_float_sse2(a + i, b + i, n - i);
+}
+
+inline size_t __mismatch_double_sse2(const double* a, const double* b,
+                                     size_t n)
+{
+  size_t i = 0;
+  for ( ; i + 2 <= n; i += 2) {
+    int mask = _mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(a + i),
+                                            _mm_loadu_pd(b + i)));
+    if (mask != 0x3)
+      return i + __builtin_ctz(~mask);
+  }
+  return i + __simd_mismatch<double>(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+inline size_t __mismatch_double_avx2(const double* a, const double* b,
+                                     size_t n)
+{
+  size_t i = 0;
+  for ( ; i + 4 <= n; i += 4) {
+    int mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(a + i),
+                                                _mm256_loadu_pd(b + i),
+                                                _CMP_EQ_OQ));
+    if (mask != 0xf)
+      return i + __builtin_ctz(~mask);
+  }
+  return i + __mismatch_double_sse2(a + i, b + i, n - i);
+}
+
+inline size_t __mismatch_bytes(const char* a, const char* b, size_t n)
+{
+  return __simd_has_avx2() ? __mismatch_bytes_avx2(a, b, n)
+                           : __mismatch_bytes_sse2(a, b, n);
+}
+
+inline size_t __simd_mismatch(const float* a, const float* b, size_t n)
+{
+  return __simd_has_avx2() ? __mismatch_float_avx2(a, b, n)
+                           : __mismatch_float_sse2(a, b, n);
+}
+
+inline size_t __simd_mismatch(const double* a, const double* b, size_t n)
+{
+  return __simd_has_avx2() ? __mismatch_double_avx2(a, b, n)
+                           : __mismatch_double_sse2(a, b, n);
+}
+
+#else /* __STL_SIMD_X86_64 */
+
+inline size_t __mismatch_bytes(const char* a, const char* b, size_t n)
+{
+  return __mismatch_bytes_scalar(a, b, n);
+}
+
+#endif /* __STL_SIMD_X86_64 */
+
+// 整数类型按字节比较, 第一个不同的字节所在的元素就是第一个不相等的元素
+#define __STL_SIMD_BYTEWISE_MISMATCH(T)                                     \
+  __STL_TEMPLATE_NULL struct __simd_comparable<T>                           \
+  {                                                                         \
+    typedef __true_type type;                                               \
+  };                                                                        \
+  inline size_t __simd_mismatch(const T* a, const T* b, size_t n)           \
+  {                                                                         \
+    return __mismatch_bytes((const char*) a, (const char*) b,               \
+                            n * sizeof(T)) / sizeof(T);                     \
+  }
+
+#ifndef __STL_NO_BOOL
+__STL_SIMD_BYTEWISE_MISMATCH(bool)
+#endif
+__STL_SIMD_BYTEWISE_MISMATCH(char)
+__STL_SIMD_BYTEWISE_MISMATCH(signed char)
+__STL_SIMD_BYTEWISE_MISMATCH(unsigned char)
+#ifdef __STL_HAS_WCHAR_T
+__STL_SIMD_BYTEWISE_MISMATCH(wchar_t)
+#endif
+__STL_SIMD_BYTEWISE_MISMATCH(short)
+__STL_SIMD_BYTEWISE_MISMATCH(unsigned short)
+__STL_SIMD_BYTEWISE_MISMATCH(int)
+__STL_SIMD_BYTEWISE_MISMATCH(unsigned int)
+__STL_SIMD_BYTEWISE_MISMATCH(long)
+__STL_SIMD_BYTEWISE_MISMATCH(unsigned long)
+#ifdef __STL_LONG_LONG
+__STL_SIMD_BYTEWISE_MISMATCH(long long)
+__STL_SIMD_BYTEWISE_MISMATCH(unsigned long long)
+#endif
+
+#undef __STL_SIMD_BYTEWISE_MISMATCH
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma reset woff 1174
+#endif
+
+__STL_END_NAMESPACE
+
+#endif /* __SGI_STL_INTERNAL_SIMD_COMPARE_H */
+
+// Local Variables:
+// mode:C++
+// End:
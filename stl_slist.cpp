@@ -2,6 +2,10 @@
 #ifndef __SGI_STL_INTERNAL_SLIST_H
 #define __SGI_STL_INTERNAL_SLIST_H
 
+// <stl_config.h>里没有右值引用的开关, 按编译器的语言版本判断
+#if !defined(__STL_RVALUE_REFERENCES) && __cplusplus >= 201103L
+#  define __STL_RVALUE_REFERENCES
+#endif
 
 __STL_BEGIN_NAMESPACE
 
@@ -9,6 +13,24 @@ __STL_BEGIN_NAMESPACE
 #pragma set woff 1174
 #endif
 
+// 定义__STL_SLIST_USE_PREFETCH后, remove/unique/merge/operator==和擦除区间
+// 这些在每个结点上还有比较或析构工作的循环, 会在处理当前结点的同时
+// 预取下一个结点, 让这次cache miss和当前结点上的工作重叠起来
+// 预取距离固定为1: 单链表只能沿着next一个一个找, 要预取更远的结点,
+// 必须先等中间的结点到达, 这条依赖链本身就是瓶颈, 加大距离没有收益;
+// 同理__slist_size/__slist_previous/__slist_reverse这种只追指针的循环
+// 没有可以重叠的工作, 不做预取
+#if defined(__STL_SLIST_USE_PREFETCH) && defined(__GNUC__)
+#  define __STL_SLIST_PREFETCH(node) __builtin_prefetch(node)
+#else
+#  define __STL_SLIST_PREFETCH(node)
+#endif
+
+// 慢路径的计数和计时, 见<stl_instrument.h>; 没有打开时为空
+#ifndef __STL_PROBE
+#  define __STL_PROBE(probe)
+#endif
+
 // 这个是链表结点的指针域
 struct __slist_node_base
 {
@@ -24,10 +46,52 @@ inline __slist_node_base* __slist_make_link(__slist_node_base* prev_node,
   return new_node;
 }
 
+// 批量插入时每次取得的结点数
+// 一批结点先全部取得再逐个构造, 批太大时第二遍访问的结点已经不在缓存中
+enum { __slist_chain_length = 16 };
+
+// 在pos后面插入n个依次用*first构造的元素, 返回最后一个结点
+// 每批先用acquire取得最多__slist_chain_length个未构造的结点, 再一边构造一边链接
+// 和逐个插入一样, 失败时已经插入的元素保留在链表中, 这一批剩下的结点交给release
+template <class Node, class Source>
+__slist_node_base* __slist_link_n(__slist_node_base* pos, size_t n,
+                                  Source first, Node* (*acquire)(size_t),
+                                  void (*release)(__slist_node_base*))
+{
+  while (n > 0) {
+    size_t k = n < size_t(__slist_chain_length) ? n
+                                                : size_t(__slist_chain_length);
+    Node* chain = acquire(k);
+    n -= k;
+    __STL_TRY {
+      while (chain) {
+        construct(&chain->data, *first);
+        Node* next = (Node*) chain->next;
+        pos = __slist_make_link(pos, chain);
+        chain = next;
+        ++first;
+      }
+    }
+    __STL_UNWIND(release(chain));
+  }
+  return pos;
+}
+
+// n个值为x的元素, 供__slist_link_n()使用
+template <class T>
+struct __slist_fill_source
+{
+  const T* value;
+  explicit __slist_fill_source(const T& x) : value(&x) {}
+  const T& operator*() const { return *value; }
+  __slist_fill_source& operator++() { return *this; }
+};
+
 // 获取指定结点的前一个结点
 inline __slist_node_base* __slist_previous(__slist_node_base* head,
                                            const __slist_node_base* node)
 {
+  __STL_PROBE(slist_previous);
   while (head && head->next != node)
     head = head->next;
   return head;
@@ -36,11 +100,31 @@ inline __slist_node_base* __slist_previous(__slist_node_base* head,
 inline const __slist_node_base* __slist_previous(const __slist_node_base* head,
                                                  const __slist_node_base* node)
 {
+  __STL_PROBE(slist_previous);
   while (head && head->next != node)
     head = head->next;
   return head;
 }
 
+// 从hint开始向后查找node的前驱结点, hint必须是head或者链表中的某个结点
+// 如果node不在hint之后, 再从head开始找到hint为止
+// 在同一位置附近反复查找时均摊O(1), 最坏情况和上面的版本一样是O(n)
+inline __slist_node_base* __slist_previous(__slist_node_base* head,
+                                           __slist_node_base* hint,
+                                           const __slist_node_base* node)
+{
+  __STL_PROBE(slist_previous);
+  __slist_node_base* prev = hint;
+  while (prev && prev->next != node)
+    prev = prev->next;
+  if (prev)
+    return prev;
+  prev = head;
+  while (prev != hint && prev->next != node)
+    prev = prev->next;
+  return prev;
+}
+
 inline void __slist_splice_after(__slist_node_base* pos,
                                  __slist_node_base* before_first,
                                  __slist_node_base* before_last)
@@ -167,6 +251,128 @@ inline size_t __slist_size(__slist_node_base* node)
   return result;
 }
 
+// unique_unsorted()和remove_all()使用的开放定址哈希集合
+// 只保存元素的指针, 不复制元素; 线性探测, 容量是2的幂, 装载因子不超过1/2
+template <class T, class HashFcn, class EqualKey, class Alloc>
+class __slist_probe_set
+{
+  typedef simple_alloc<const T*, Alloc> table_allocator;
+
+  const T** table;
+  size_t mask;         // 容量 - 1
+  size_t num_elements;
+  HashFcn hash;
+  EqualKey equals;
+
+  // 像hash<int>这样的恒等哈希直接取低位会聚集成团, 先打散一下
+  size_t bucket(const T& x) const
+  {
+    size_t h = hash(x);
+    h ^= h >> 15;
+    h *= size_t(2654435761UL);
+    h ^= h >> 13;
+    return h & mask;
+  }
+
+  void grow()
+  {
+    size_t old_size = mask + 1;
+    const T** old_table = table;
+    table = table_allocator::allocate(old_size * 2);
+    fill(table, table + old_size * 2, (const T*) 0);
+    mask = old_size * 2 - 1;
+    for (size_t i = 0; i < old_size; ++i)
+      if (old_table[i]) {
+        size_t j = bucket(*old_table[i]);
+        while (table[j])
+          j = (j + 1) & mask;
+        table[j] = old_table[i];
+      }
+    table_allocator::deallocate(old_table, old_size);
+  }
+
+public:
+  __slist_probe_set(const HashFcn& hf, const EqualKey& eql)
+    : mask(15), num_elements(0), hash(hf), equals(eql)
+  {
+    table = table_allocator::allocate(mask + 1);
+    fill(table, table + mask + 1, (const T*) 0);
+  }
+  ~__slist_probe_set() { table_allocator::deallocate(table, mask + 1); }
+
+  // 如果已经有等价的元素返回false, 否则记录p并返回true
+  bool insert(const T* p)
+  {
+    if (2 * (num_elements + 1) > mask + 1)
+      grow();
+    size_t i = bucket(*p);
+    while (table[i]) {
+      if (equals(*table[i], *p))
+        return false;
+      i = (i + 1) & mask;
+    }
+    table[i] = p;
+    ++num_elements;
+    return true;
+  }
+
+  bool contains(const T& x) const
+  {
+    size_t i = bucket(x);
+    while (table[i]) {
+      if (equals(*table[i], x))
+        return true;
+      i = (i + 1) & mask;
+    }
+    return false;
+  }
+};
+
+// merge_k()使用的败者树
+// 叶子s对应第s条链表当前的第一个结点, tree[1 .. m - 1]记录每场比赛的败者,
+// tree[0]是冠军; 下标m是建树时使用的虚拟选手, 它胜过所有人
+// 已经取空的链表输给所有人; 相等时下标小的获胜, 从而保证稳定
+template <class Node, class StrictWeakOrdering>
+struct __slist_loser_tree
+{
+  Node** cur;
+  size_t* tree;
+  size_t m;
+  StrictWeakOrdering comp;
+
+  __slist_loser_tree(Node** c, size_t* t, size_t n, StrictWeakOrdering cmp)
+    : cur(c), tree(t), m(n), comp(cmp)
+  {
+    for (size_t i = 0; i < m; ++i)
+      tree[i] = m;
+    for (size_t s = m; s > 0; --s)
+      adjust(s - 1);
+  }
+
+  bool beats(size_t a, size_t b) const
+  {
+    if (a == m) return true;
+    if (b == m) return false;
+    if (cur[a] == 0) return false;
+    if (cur[b] == 0) return true;
+    if (comp(cur[a]->data, cur[b]->data)) return true;
+    if (comp(cur[b]->data, cur[a]->data)) return false;
+    return a < b;
+  }
+
+  // 叶子s的值变化后, 沿着到根的路径重赛
+  void adjust(size_t s)
+  {
+    for (size_t t = (s + m) / 2; t > 0; t /= 2)
+      if (beats(tree[t], s)) {
+        size_t tmp = tree[t];
+        tree[t] = s;
+        s = tmp;
+      }
+    tree[0] = s;
+  }
+};
+
 template <class T, class Alloc = alloc>
 class slist
 {
@@ -183,7 +389,7 @@ public:
   typedef __slist_iterator<T, T&, T*>             iterator;  // STL标准强制要求
   typedef __slist_iterator<T, const T&, const T*> const_iterator;
 
-private:
+protected:
   typedef __slist_node<T> list_node;
   typedef __slist_node_base list_node_base;
   typedef __slist_iterator_base iterator_base;
@@ -210,6 +416,36 @@ private:
     list_node_allocator::deallocate(node);
   }
 
+  // 取得n个未构造的结点, 按分配的顺序用next串成一条链, 见__slist_link_n()
+  // 每个结点都单独向list_node_allocator申请, 和create_node()一样,
+  // 所以destroy_node()释放的结点回到同样大小的自由链表, 之后还能被重新使用;
+  // 申请失败时已取得的结点全部归还
+  static list_node* allocate_chain(size_t n)
+  {
+    list_node_base chain;
+    list_node_base* tail = &chain;
+    tail->next = 0;
+    __STL_TRY {
+      for ( ; n > 0; --n) {
+        tail->next = list_node_allocator::allocate();
+        tail = tail->next;
+        tail->next = 0;
+      }
+    }
+    __STL_UNWIND(deallocate_chain(chain.next));
+    return (list_node*) chain.next;
+  }
+
+  // 归还一条未构造的结点链
+  static void deallocate_chain(list_node_base* chain)
+  {
+    while (chain) {
+      list_node_base* next = chain->next;
+      list_node_allocator::deallocate((list_node*) chain);
+      chain = next;
+    }
+  }
+
   void fill_initialize(size_type n, const value_type& x)
   {
     head.next = 0;
@@ -247,7 +483,7 @@ private:
   }
 #endif /* __STL_MEMBER_TEMPLATES */
 
-private:
+protected:
   list_node_base head;  // 这是链表头
 
 public:
@@ -278,6 +514,39 @@ public:
 
   slist& operator= (const slist& L);
 
+#ifdef __STL_RVALUE_REFERENCES
+  // 移动只需要接管对方的链表头, O(1), 不复制也不分配任何结点
+  slist(slist&& L)
+  {
+    head.next = L.head.next;
+    L.head.next = 0;
+  }
+
+  slist& operator= (slist&& L)
+  {
+    if (&L != this) {
+      clear();
+      swap(L);
+    }
+    return *this;
+  }
+#endif /* __STL_RVALUE_REFERENCES */
+
+  // 把内容替换成n个x或者[first, last)
+  // 已有的结点直接赋值重复利用, 多余的擦除;
+  // 不够的部分和insert一样按批分配(见__slist_link_n()), 输入迭代器只能逐个分配
+  void assign(size_type n, const T& x);
+  void assign(int n, const T& x) { assign((size_type) n, x); }
+  void assign(long n, const T& x) { assign((size_type) n, x); }
+
+#ifdef __STL_MEMBER_TEMPLATES
+  template <class InputIterator>
+  void assign(InputIterator first, InputIterator last);
+#else /* __STL_MEMBER_TEMPLATES */
+  void assign(const_iterator first, const_iterator last);
+  void assign(const value_type* first, const value_type* last);
+#endif /* __STL_MEMBER_TEMPLATES */
+
   // 析构所有元素, 并释放内存
   ~slist() { clear(); }
 
@@ -340,7 +609,7 @@ public:
     return const_iterator((list_node*) __slist_previous(&head, pos.node));
   }
 
-private:
+protected:
   // 在指定结点后插入值为x的元素, 分配内存
   list_node* _insert_after(list_node_base* pos, const value_type& x)
   {
@@ -348,38 +617,53 @@ private:
   }
 
   // 在指定结点后面插入n个值为x的元素
+  // 按批取得结点, 再一边构造一边链接, 见__slist_link_n()
   void _insert_after_fill(list_node_base* pos,
                           size_type n, const value_type& x)
   {
-    for (size_type i = 0; i < n; ++i)
-      pos = __slist_make_link(pos, create_node(x));
+    __slist_link_n(pos, n, __slist_fill_source<value_type>(x),
+                   allocate_chain, deallocate_chain);
   }
 
-// TODO: 待分析
 // 在pos后面插入[first, last)区间内的元素
+// 前向迭代器可以先算出元素个数, 和_insert_after_fill()一样按批取得结点
 #ifdef __STL_MEMBER_TEMPLATES
   template <class InIter>
   void _insert_after_range(list_node_base* pos, InIter first, InIter last)
+  {
+    _insert_after_range(pos, first, last, iterator_category(first));
+  }
+
+  template <class InIter>
+  void _insert_after_range(list_node_base* pos, InIter first, InIter last,
+                           input_iterator_tag)
   {
     while (first != last) {
       pos = __slist_make_link(pos, create_node(*first));
       ++first;
     }
   }
+
+  template <class ForwardIterator>
+  void _insert_after_range(list_node_base* pos,
+                           ForwardIterator first, ForwardIterator last,
+                           forward_iterator_tag)
+  {
+    size_type n = 0;
+    distance(first, last, n);
+    __slist_link_n(pos, n, first, allocate_chain, deallocate_chain);
+  }
 #else /* __STL_MEMBER_TEMPLATES */
   void _insert_after_range(list_node_base* pos,
                            const_iterator first, const_iterator last) {
-    while (first != last) {
-      pos = __slist_make_link(pos, create_node(*first));
-      ++first;
-    }
+    size_type n = 0;
+    distance(first, last, n);
+    __slist_link_n(pos, n, first, allocate_chain, deallocate_chain);
   }
   void _insert_after_range(list_node_base* pos,
                            const value_type* first, const value_type* last) {
-    while (first != last) {
-      pos = __slist_make_link(pos, create_node(*first));
-      ++first;
-    }
+    __slist_link_n(pos, size_t(last - first), first,
+                   allocate_chain, deallocate_chain);
   }
 #endif /* __STL_MEMBER_TEMPLATES */
 
@@ -401,6 +685,7 @@ private:
     while (cur != last_node) {
       list_node* tmp = cur;
       cur = (list_node*) cur->next;
+      __STL_SLIST_PREFETCH(cur);
       destroy_node(tmp);
     }
     before_first->next = last_node;
@@ -568,11 +853,43 @@ public:
   void merge(slist& L);
   void sort();
 
+  // unique()只能去掉相邻的重复元素, 无序链表要先sort()
+  // 这里用哈希集合一遍扫描去掉所有重复元素, 保留每个值第一次出现的结点, O(n)
+  // 默认版本需要<stl_hash_fun.h>中的hash<T>
+  void unique_unsorted();
+
 #ifdef __STL_MEMBER_TEMPLATES
   template <class Predicate> void remove_if(Predicate pred);
   template <class BinaryPredicate> void unique(BinaryPredicate pred);
   template <class StrictWeakOrdering> void merge(slist&, StrictWeakOrdering);
   template <class StrictWeakOrdering> void sort(StrictWeakOrdering comp);
+
+  template <class HashFcn, class EqualKey>
+  void unique_unsorted(HashFcn hf, EqualKey eql);
+
+  // 擦除所有在s中出现过的元素, s可以是任意容器
+  // 先把s的元素放进哈希集合, 再一遍扫描链表, O(n + s.size())
+  template <class Set> void remove_all(const Set& s);
+  template <class Set, class HashFcn, class EqualKey>
+  void remove_all(const Set& s, HashFcn hf, EqualKey eql);
+
+  // 把k条有序链表一次归并到本链表中(本链表也必须有序), 之后lists[i]都为空
+  // 用败者树每次从k + 1个候选中选出最小的结点, O(n log k), 只重新链接不分配结点;
+  // 两两merge()的总代价是O(n * k)
+  // 相等的元素按本链表、lists[0]、lists[1]...的顺序排列, 与merge()一致
+  void merge_k(slist* lists, size_type k);
+  template <class StrictWeakOrdering>
+  void merge_k(slist* lists, size_type k, StrictWeakOrdering comp);
+
+#ifdef __STL_PTHREADS
+  // 并行排序, 需要<stl_parallel.h>
+  // 遍历一次把链表切成nthreads段, 每段在一个线程上sort(), 再两两归并
+  // 归并同样按层并行; 结果和sort()完全一致(都是稳定排序)
+  // nthreads为0时使用在线CPU数, 最多64段; comp不能抛出异常
+  void parallel_sort(size_t nthreads = 0);
+  template <class StrictWeakOrdering>
+  void parallel_sort(size_t nthreads, StrictWeakOrdering comp);
+#endif /* __STL_PTHREADS */
 #endif /* __STL_MEMBER_TEMPLATES */
 };
 
@@ -599,15 +916,92 @@ slist<T, Alloc>& slist<T,Alloc>::operator=(const slist<T, Alloc>& L)
   return *this;
 }
 
+template <class T, class Alloc>
+void slist<T, Alloc>::assign(size_type n, const T& x)
+{
+  list_node_base* prev = &head;
+  list_node* node = (list_node*) head.next;
+  for ( ; node != 0 && n > 0; --n) {
+    node->data = x;
+    prev = node;
+    node = (list_node*) node->next;
+  }
+  if (n > 0)
+    _insert_after_fill(prev, n, x);
+  else
+    erase_after(prev, 0);
+}
+
+#ifdef __STL_MEMBER_TEMPLATES
+
+template <class T, class Alloc> template <class InputIterator>
+void slist<T, Alloc>::assign(InputIterator first, InputIterator last)
+{
+  list_node_base* prev = &head;
+  list_node* node = (list_node*) head.next;
+  for ( ; node != 0 && first != last; ++first) {
+    node->data = *first;
+    prev = node;
+    node = (list_node*) node->next;
+  }
+  if (first != last)
+    _insert_after_range(prev, first, last);
+  else
+    erase_after(prev, 0);
+}
+
+#else /* __STL_MEMBER_TEMPLATES */
+
+template <class T, class Alloc>
+void slist<T, Alloc>::assign(const_iterator first, const_iterator last)
+{
+  list_node_base* prev = &head;
+  list_node* node = (list_node*) head.next;
+  for ( ; node != 0 && first != last; ++first) {
+    node->data = *first;
+    prev = node;
+    node = (list_node*) node->next;
+  }
+  if (first != last)
+    _insert_after_range(prev, first, last);
+  else
+    erase_after(prev, 0);
+}
+
+template <class T, class Alloc>
+void slist<T, Alloc>::assign(const value_type* first, const value_type* last)
+{
+  list_node_base* prev = &head;
+  list_node* node = (list_node*) head.next;
+  for ( ; node != 0 && first != last; ++first) {
+    node->data = *first;
+    prev = node;
+    node = (list_node*) node->next;
+  }
+  if (first != last)
+    _insert_after_range(prev, first, last);
+  else
+    erase_after(prev, 0);
+}
+
+#endif /* __STL_MEMBER_TEMPLATES */
+
 // 只有两个链表所有内容都相等才判定其等价
 // 不过个人觉得只需要判断头结点指向的第一个结点就可以
+// 注意: 不能像deque那样用__simd_mismatch()向量化, 结点是逐个分配的,
+// 在内存中不连续, 每个元素旁边还有next指针; 瓶颈是沿着next的逐个访存,
+// 不是比较本身, 所以这里只做预取(见__STL_SLIST_USE_PREFETCH)
 template <class T, class Alloc>
 bool operator==(const slist<T, Alloc>& L1, const slist<T, Alloc>& L2)
 {
   typedef typename slist<T,Alloc>::list_node list_node;
   list_node* n1 = (list_node*) L1.head.next;
   list_node* n2 = (list_node*) L2.head.next;
-  while (n1 && n2 && n1->data == n2->data) {
+  while (n1 && n2) {
+    __STL_SLIST_PREFETCH(n1->next);
+    __STL_SLIST_PREFETCH(n2->next);
+    if (!(n1->data == n2->data))
+      break;
     n1 = (list_node*) n1->next;
     n2 = (list_node*) n2->next;
   }
@@ -653,6 +1047,7 @@ void slist<T,Alloc>::remove(const T& val)
 {
   list_node_base* cur = &head;
   while (cur && cur->next) {
+    __STL_SLIST_PREFETCH(cur->next->next);
     if (((list_node*) cur->next)->data == val)
       erase_after(cur);
     else
@@ -666,6 +1061,7 @@ void slist<T,Alloc>::unique()
   list_node_base* cur = head.next;
   if (cur) {
     while (cur->next) {
+      __STL_SLIST_PREFETCH(cur->next->next);
       if (((list_node*)cur)->data == ((list_node*)(cur->next))->data)
         erase_after(cur);
       else
@@ -674,11 +1070,28 @@ void slist<T,Alloc>::unique()
   }
 }
 
+template <class T, class Alloc>
+void slist<T,Alloc>::unique_unsorted()
+{
+  hash<T> hf;
+  equal_to<T> eql;
+  __slist_probe_set<T, hash<T>, equal_to<T>, Alloc> seen(hf, eql);
+  list_node_base* cur = &head;
+  while (cur->next) {
+    if (seen.insert(&((list_node*) cur->next)->data))
+      cur = cur->next;
+    else
+      erase_after(cur);
+  }
+}
+
 template <class T, class Alloc>
 void slist<T,Alloc>::merge(slist<T,Alloc>& L)
 {
   list_node_base* n1 = &head;
   while (n1->next && L.head.next) {
+    __STL_SLIST_PREFETCH(n1->next->next);
+    __STL_SLIST_PREFETCH(L.head.next->next);
     if (((list_node*) L.head.next)->data < ((list_node*) n1->next)->data)
       __slist_splice_after(n1, &L.head, L.head.next);
     n1 = n1->next;
@@ -722,6 +1135,7 @@ template <class Predicate> void slist<T,Alloc>::remove_if(Predicate pred)
 {
   list_node_base* cur = &head;
   while (cur->next) {
+    __STL_SLIST_PREFETCH(cur->next->next);
     if (pred(((list_node*) cur->next)->data))
       erase_after(cur);
     else
@@ -735,6 +1149,7 @@ void slist<T,Alloc>::unique(BinaryPredicate pred)
   list_node* cur = (list_node*) head.next;
   if (cur) {
     while (cur->next) {
+      __STL_SLIST_PREFETCH(cur->next->next);
       if (pred(((list_node*)cur)->data, ((list_node*)(cur->next))->data))
         erase_after(cur);
       else
@@ -748,6 +1163,8 @@ void slist<T,Alloc>::merge(slist<T,Alloc>& L, StrictWeakOrdering comp)
 {
   list_node_base* n1 = &head;
   while (n1->next && L.head.next) {
+    __STL_SLIST_PREFETCH(n1->next->next);
+    __STL_SLIST_PREFETCH(L.head.next->next);
     if (comp(((list_node*) L.head.next)->data,
              ((list_node*) n1->next)->data))
       __slist_splice_after(n1, &L.head, L.head.next);
@@ -785,8 +1202,572 @@ void slist<T,Alloc>::sort(StrictWeakOrdering comp)
   }
 }
 
+template <class T, class Alloc> template <class HashFcn, class EqualKey>
+void slist<T,Alloc>::unique_unsorted(HashFcn hf, EqualKey eql)
+{
+  __slist_probe_set<T, HashFcn, EqualKey, Alloc> seen(hf, eql);
+  list_node_base* cur = &head;
+  while (cur->next) {
+    if (seen.insert(&((list_node*) cur->next)->data))
+      cur = cur->next;
+    else
+      erase_after(cur);
+  }
+}
+
+template <class T, class Alloc> template <class Set>
+void slist<T,Alloc>::remove_all(const Set& s)
+{
+  remove_all(s, hash<T>(), equal_to<T>());
+}
+
+template <class T, class Alloc>
+template <class Set, class HashFcn, class EqualKey>
+void slist<T,Alloc>::remove_all(const Set& s, HashFcn hf, EqualKey eql)
+{
+  __slist_probe_set<T, HashFcn, EqualKey, Alloc> doomed(hf, eql);
+  for (typename Set::const_iterator i = s.begin(); i != s.end(); ++i)
+    doomed.insert(&*i);
+  list_node_base* cur = &head;
+  while (cur->next) {
+    if (doomed.contains(((list_node*) cur->next)->data))
+      erase_after(cur);
+    else
+      cur = cur->next;
+  }
+}
+
+template <class T, class Alloc>
+void slist<T,Alloc>::merge_k(slist* lists, size_type k)
+{
+  merge_k(lists, k, less<T>());
+}
+
+template <class T, class Alloc> template <class StrictWeakOrdering>
+void slist<T,Alloc>::merge_k(slist* lists, size_type k,
+                             StrictWeakOrdering comp)
+{
+  typedef simple_alloc<list_node*, Alloc> cursor_allocator;
+  typedef simple_alloc<size_t, Alloc> tree_allocator;
+
+  // 第0路是本链表, 第i + 1路是lists[i], 先把各路的结点链都摘下来
+  size_t m = k + 1;
+  list_node** cur = cursor_allocator::allocate(m);
+  size_t* tree;
+  __STL_TRY {
+    tree = tree_allocator::allocate(m);
+  }
+  __STL_UNWIND(cursor_allocator::deallocate(cur, m));
+  cur[0] = (list_node*) head.next;
+  head.next = 0;
+  for (size_type i = 0; i < k; ++i) {
+    if (&lists[i] == this) {
+      cur[i + 1] = 0;
+      continue;
+    }
+    cur[i + 1] = (list_node*) lists[i].head.next;
+    lists[i].head.next = 0;
+  }
+
+  list_node_base* tail = &head;
+  __STL_TRY {
+    __slist_loser_tree<list_node, StrictWeakOrdering> lt(cur, tree, m, comp);
+    // 冠军已经取空说明所有链表都取空了
+    while (cur[tree[0]]) {
+      size_t s = tree[0];
+      tail->next = cur[s];
+      tail = cur[s];
+      cur[s] = (list_node*) cur[s]->next;
+      lt.adjust(s);
+    }
+    tail->next = 0;
+  }
+#     ifdef __STL_USE_EXCEPTIONS
+  // comp抛出异常时结果无序, 但是把剩下的结点都接回本链表, 不丢失任何元素
+  catch(...) {
+    for (size_t s = 0; s < m; ++s)
+      if (cur[s]) {
+        tail->next = cur[s];
+        tail = __slist_previous(cur[s], 0);
+      }
+    tail->next = 0;
+    tree_allocator::deallocate(tree, m);
+    cursor_allocator::deallocate(cur, m);
+    throw;
+  }
+#     endif /* __STL_USE_EXCEPTIONS */
+  tree_allocator::deallocate(tree, m);
+  cursor_allocator::deallocate(cur, m);
+}
+
+#ifdef __STL_PTHREADS
+
+// parallel_sort()的工作函数, 每份排序一段
+template <class List, class StrictWeakOrdering>
+struct __slist_sort_chunk
+{
+  List* chunks;
+  StrictWeakOrdering comp;
+
+  __slist_sort_chunk(List* c, StrictWeakOrdering cmp) : chunks(c), comp(cmp) {}
+  void operator()(size_t i) { chunks[i].sort(comp); }
+};
+
+// 第i份把chunks[2 * i * width + width]归并到chunks[2 * i * width]
+// 左边的段在前, 相等元素保持原来的先后顺序
+template <class List, class StrictWeakOrdering>
+struct __slist_merge_chunk
+{
+  List* chunks;
+  size_t width;
+  size_t count;
+  StrictWeakOrdering comp;
+
+  __slist_merge_chunk(List* c, size_t w, size_t n, StrictWeakOrdering cmp)
+    : chunks(c), width(w), count(n), comp(cmp) {}
+  void operator()(size_t i)
+  {
+    size_t left = 2 * i * width;
+    if (left + width < count)
+      chunks[left].merge(chunks[left + width], comp);
+  }
+};
+
+template <class T, class Alloc>
+void slist<T,Alloc>::parallel_sort(size_t nthreads)
+{
+  parallel_sort(nthreads, less<T>());
+}
+
+template <class T, class Alloc> template <class StrictWeakOrdering>
+void slist<T,Alloc>::parallel_sort(size_t nthreads, StrictWeakOrdering comp)
+{
+  if (nthreads == 0)
+    nthreads = __parallel_default_threads();
+  if (nthreads > 64)
+    nthreads = 64;
+  size_type n = size();
+  // 每段太短时线程开销得不偿失
+  if (nthreads < 2 || n < 1024 * nthreads) {
+    sort(comp);
+    return;
+  }
+
+  slist chunks[64];
+  for (size_t i = 0; i < nthreads; ++i) {
+    size_type len = n / nthreads + (i < n % nthreads ? 1 : 0);
+    list_node_base* last = &head;
+    for (size_type k = 0; k < len; ++k)
+      last = last->next;
+    chunks[i].head.next = head.next;
+    head.next = last->next;
+    last->next = 0;
+  }
+
+  __slist_sort_chunk<slist, StrictWeakOrdering> sorter(chunks, comp);
+  __parallel_run(nthreads, sorter);
+
+  for (size_t width = 1; width < nthreads; width *= 2) {
+    __slist_merge_chunk<slist, StrictWeakOrdering>
+      merger(chunks, width, nthreads, comp);
+    __parallel_run((nthreads + 2 * width - 1) / (2 * width), merger);
+  }
+  this->swap(chunks[0]);
+}
+
+#endif /* __STL_PTHREADS */
+
 #endif /* __STL_MEMBER_TEMPLATES */
 
+// 带前驱缓存的slist
+// slist的previous(), insert(pos, ...), erase(pos)都要调用__slist_previous
+// 从链表头开始查找前驱, 每次都是O(n)
+// indexed_slist记住上一次找到的前驱结点, 下一次先从它开始向后找,
+// 在一个游标附近反复插入/删除时均摊O(1)
+// 任何释放结点或者把结点移出链表的操作都必须维护这个缓存,
+// 所以这里私有继承slist, 只开放不会使缓存失效的接口, 其余的接口重新实现
+template <class T, class Alloc = alloc>
+class indexed_slist : private slist<T, Alloc>
+{
+  typedef slist<T, Alloc> base;
+
+public:
+  typedef typename base::value_type value_type;
+  typedef typename base::pointer pointer;
+  typedef typename base::const_pointer const_pointer;
+  typedef typename base::reference reference;
+  typedef typename base::const_reference const_reference;
+  typedef typename base::size_type size_type;
+  typedef typename base::difference_type difference_type;
+
+  typedef typename base::iterator iterator;
+  typedef typename base::const_iterator const_iterator;
+
+private:
+  typedef typename base::list_node list_node;
+  typedef typename base::list_node_base list_node_base;
+
+  // 要么是&head, 要么是本链表中的某个结点
+  mutable list_node_base* hint;
+
+  list_node_base* _previous(const list_node_base* node) const
+  {
+    hint = __slist_previous((list_node_base*) &this->head, hint, node);
+    return hint;
+  }
+
+  void reset_hint() const { hint = (list_node_base*) &this->head; }
+
+public:
+  indexed_slist() { reset_hint(); }
+
+  indexed_slist(size_type n, const value_type& x) : base(n, x) { reset_hint(); }
+  indexed_slist(int n, const value_type& x) : base(n, x) { reset_hint(); }
+  indexed_slist(long n, const value_type& x) : base(n, x) { reset_hint(); }
+  explicit indexed_slist(size_type n) : base(n) { reset_hint(); }
+
+#ifdef __STL_MEMBER_TEMPLATES
+  template <class InputIterator>
+  indexed_slist(InputIterator first, InputIterator last) : base(first, last)
+  {
+    reset_hint();
+  }
+#else /* __STL_MEMBER_TEMPLATES */
+  indexed_slist(const_iterator first, const_iterator last) : base(first, last)
+  {
+    reset_hint();
+  }
+  indexed_slist(const value_type* first, const value_type* last)
+    : base(first, last)
+  {
+    reset_hint();
+  }
+#endif /* __STL_MEMBER_TEMPLATES */
+
+  indexed_slist(const indexed_slist& L) : base(L) { reset_hint(); }
+
+  // 赋值可能会擦除结点, 直接作废缓存
+  indexed_slist& operator= (const indexed_slist& L)
+  {
+    base::operator=(L);
+    reset_hint();
+    return *this;
+  }
+
+#ifdef __STL_RVALUE_REFERENCES
+  indexed_slist(indexed_slist&& L) : base(static_cast<base&&>(L))
+  {
+    reset_hint();
+    L.reset_hint();
+  }
+
+  indexed_slist& operator= (indexed_slist&& L)
+  {
+    base::operator=(static_cast<base&&>(L));
+    reset_hint();
+    L.reset_hint();
+    return *this;
+  }
+#endif /* __STL_RVALUE_REFERENCES */
+
+  void assign(size_type n, const T& x)
+  {
+    base::assign(n, x);
+    reset_hint();
+  }
+  void assign(int n, const T& x) { assign((size_type) n, x); }
+  void assign(long n, const T& x) { assign((size_type) n, x); }
+
+#ifdef __STL_MEMBER_TEMPLATES
+  template <class InputIterator>
+  void assign(InputIterator first, InputIterator last)
+  {
+    base::assign(first, last);
+    reset_hint();
+  }
+#else /* __STL_MEMBER_TEMPLATES */
+  void assign(const_iterator first, const_iterator last)
+  {
+    base::assign(first, last);
+    reset_hint();
+  }
+  void assign(const value_type* first, const value_type* last)
+  {
+    base::assign(first, last);
+    reset_hint();
+  }
+#endif /* __STL_MEMBER_TEMPLATES */
+
+public:
+  // 下面这些操作只会新增结点或者不改变结点, 缓存保持有效
+  using base::begin;
+  using base::end;
+  using base::size;
+  using base::max_size;
+  using base::empty;
+  using base::front;
+  using base::push_front;
+  using base::insert_after;
+  using base::reverse;
+
+  // 交换后缓存指向的是对方的结点, 两边都作废
+  void swap(indexed_slist& L)
+  {
+    base::swap(L);
+    reset_hint();
+    L.reset_hint();
+  }
+
+  void pop_front()
+  {
+    if (hint == this->head.next)
+      reset_hint();
+    base::pop_front();
+  }
+
+  iterator previous(const_iterator pos)
+  {
+    return iterator((list_node*) _previous(pos.node));
+  }
+  const_iterator previous(const_iterator pos) const
+  {
+    return const_iterator((list_node*) _previous(pos.node));
+  }
+
+public:
+  // 缓存停在新结点的前驱上, 之后不管是在pos前还是在新结点前插入,
+  // 都只需要向后走一两步
+  iterator insert(iterator pos, const value_type& x)
+  {
+    return iterator(this->_insert_after(_previous(pos.node), x));
+  }
+
+  iterator insert(iterator pos) { return insert(pos, value_type()); }
+
+  void insert(iterator pos, size_type n, const value_type& x)
+  {
+    this->_insert_after_fill(_previous(pos.node), n, x);
+  }
+  void insert(iterator pos, int n, const value_type& x)
+  {
+    this->_insert_after_fill(_previous(pos.node), (size_type) n, x);
+  }
+  void insert(iterator pos, long n, const value_type& x)
+  {
+    this->_insert_after_fill(_previous(pos.node), (size_type) n, x);
+  }
+
+#ifdef __STL_MEMBER_TEMPLATES
+  template <class InIter>
+  void insert(iterator pos, InIter first, InIter last) {
+    this->_insert_after_range(_previous(pos.node), first, last);
+  }
+#else /* __STL_MEMBER_TEMPLATES */
+  void insert(iterator pos, const_iterator first, const_iterator last) {
+    this->_insert_after_range(_previous(pos.node), first, last);
+  }
+  void insert(iterator pos, const value_type* first, const value_type* last) {
+    this->_insert_after_range(_previous(pos.node), first, last);
+  }
+#endif /* __STL_MEMBER_TEMPLATES */
+
+public:
+  // 被擦除的结点如果正好是缓存, 把缓存退回到pos
+  iterator erase_after(iterator pos)
+  {
+    if (hint == pos.node->next)
+      hint = pos.node;
+    return iterator((list_node*) base::erase_after(pos.node));
+  }
+  iterator erase_after(iterator before_first, iterator last)
+  {
+    for (list_node_base* cur = before_first.node->next;
+         cur != last.node; cur = cur->next)
+      if (cur == hint) {
+        hint = before_first.node;
+        break;
+      }
+    return iterator((list_node*) base::erase_after(before_first.node,
+                                                   last.node));
+  }
+
+  // 前驱结点不会被擦除, 缓存留在前驱上
+  iterator erase(iterator pos)
+  {
+    return iterator((list_node*) base::erase_after(_previous(pos.node)));
+  }
+  iterator erase(iterator first, iterator last)
+  {
+    return iterator((list_node*) base::erase_after(_previous(first.node),
+                                                   last.node));
+  }
+
+  void resize(size_type new_size, const T& x)
+  {
+    base::resize(new_size, x);
+    reset_hint();
+  }
+  void resize(size_type new_size) { resize(new_size, T()); }
+  void clear()
+  {
+    base::clear();
+    reset_hint();
+  }
+
+public:
+  // splice只接受indexed_slist, 这样才能同时维护源链表的缓存
+  void splice_after(iterator pos, indexed_slist& L,
+                    iterator before_first, iterator before_last)
+  {
+    if (before_first != before_last) {
+      __slist_splice_after(pos.node, before_first.node, before_last.node);
+      L.reset_hint();
+    }
+  }
+
+  void splice_after(iterator pos, indexed_slist& L, iterator prev)
+  {
+    if (L.hint == prev.node->next)
+      L.hint = prev.node;
+    __slist_splice_after(pos.node, prev.node, prev.node->next);
+  }
+
+  void splice(iterator pos, indexed_slist& L)
+  {
+    if (L.head.next) {
+      __slist_splice_after(_previous(pos.node), &L.head, L._previous(0));
+      L.reset_hint();
+    }
+  }
+
+  // i的前驱留在L中, 缓存依然有效
+  void splice(iterator pos, indexed_slist& L, iterator i)
+  {
+    __slist_splice_after(_previous(pos.node), L._previous(i.node), i.node);
+  }
+
+  void splice(iterator pos, indexed_slist& L, iterator first, iterator last)
+  {
+    if (first != last)
+      __slist_splice_after(_previous(pos.node),
+                           L._previous(first.node),
+                           __slist_previous(first.node, last.node));
+  }
+
+public:
+  // 下面这些操作会批量擦除或者重排结点, 做完后直接作废缓存
+  void remove(const T& val)
+  {
+    base::remove(val);
+    reset_hint();
+  }
+  void unique()
+  {
+    base::unique();
+    reset_hint();
+  }
+  void merge(indexed_slist& L)
+  {
+    base::merge(L);
+    L.reset_hint();
+  }
+  void sort()
+  {
+    base::sort();
+    reset_hint();
+  }
+  void unique_unsorted()
+  {
+    base::unique_unsorted();
+    reset_hint();
+  }
+
+#ifdef __STL_MEMBER_TEMPLATES
+  template <class Predicate> void remove_if(Predicate pred)
+  {
+    base::remove_if(pred);
+    reset_hint();
+  }
+  template <class BinaryPredicate> void unique(BinaryPredicate pred)
+  {
+    base::unique(pred);
+    reset_hint();
+  }
+  template <class StrictWeakOrdering>
+  void merge(indexed_slist& L, StrictWeakOrdering comp)
+  {
+    base::merge(L, comp);
+    L.reset_hint();
+  }
+  template <class StrictWeakOrdering> void sort(StrictWeakOrdering comp)
+  {
+    base::sort(comp);
+    reset_hint();
+  }
+  template <class HashFcn, class EqualKey>
+  void unique_unsorted(HashFcn hf, EqualKey eql)
+  {
+    base::unique_unsorted(hf, eql);
+    reset_hint();
+  }
+  template <class Set> void remove_all(const Set& s)
+  {
+    base::remove_all(s);
+    reset_hint();
+  }
+  template <class Set, class HashFcn, class EqualKey>
+  void remove_all(const Set& s, HashFcn hf, EqualKey eql)
+  {
+    base::remove_all(s, hf, eql);
+    reset_hint();
+  }
+
+#ifdef __STL_PTHREADS
+  void parallel_sort(size_t nthreads = 0)
+  {
+    base::parallel_sort(nthreads);
+    reset_hint();
+  }
+  template <class StrictWeakOrdering>
+  void parallel_sort(size_t nthreads, StrictWeakOrdering comp)
+  {
+    base::parallel_sort(nthreads, comp);
+    reset_hint();
+  }
+#endif /* __STL_PTHREADS */
+#endif /* __STL_MEMBER_TEMPLATES */
+};
+
+template <class T, class Alloc>
+inline bool operator==(const indexed_slist<T, Alloc>& L1,
+                       const indexed_slist<T, Alloc>& L2)
+{
+  typedef typename indexed_slist<T, Alloc>::const_iterator const_iterator;
+  const_iterator i1 = L1.begin();
+  const_iterator i2 = L2.begin();
+  while (i1 != L1.end() && i2 != L2.end() && *i1 == *i2) {
+    ++i1;
+    ++i2;
+  }
+  return i1 == L1.end() && i2 == L2.end();
+}
+
+template <class T, class Alloc>
+inline bool operator<(const indexed_slist<T, Alloc>& L1,
+                      const indexed_slist<T, Alloc>& L2)
+{
+  return lexicographical_compare(L1.begin(), L1.end(), L2.begin(), L2.end());
+}
+
+#ifdef __STL_FUNCTION_TMPL_PARTIAL_ORDER
+
+template <class T, class Alloc>
+inline void swap(indexed_slist<T, Alloc>& x, indexed_slist<T, Alloc>& y) {
+  x.swap(y);
+}
+
+#endif /* __STL_FUNCTION_TMPL_PARTIAL_ORDER */
+
 #if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
 #pragma reset woff 1174
 #endif
@@ -0,0 +1,391 @@
+// Filename:    stl_small_deque.h
+// 小deque: 第一个缓冲区和map内嵌在对象中
+//
+// 普通deque即使为空, 构造时也要分配一个8个指针的map和一个缓冲区(默认512字节),
+// 对于大量只存放几个元素的deque, 这两次分配和它们占用的内存都是主要开销
+// small_deque<T, N>把一个N个元素的缓冲区和一个小map放在对象内部:
+//   元素少于N个时不进行任何动态分配;
+//   超出后照常向Alloc申请缓冲区和更大的map, 内嵌的存储空闲时还会被重新使用
+// 所有缓冲区都是N个元素, 和deque<T, Alloc, N>相同; deque总要在尾部留一个空位,
+// 所以内嵌缓冲区最多放N - 1个元素. N最好取2的幂, 元素多的deque还是应该使用普通deque
+//
+// 实现: small_deque私有继承deque<T, __small_deque_alloc<T, N, Alloc>, N>,
+// 并为这个分配器类型特化__deque_buffer_source, 在那里优先使用内嵌的存储;
+// 普通deque不为此付出任何代价
+//
+// small_deque不是一个deque:
+// 内嵌存储在使用中时不能把指针交给另一个对象, deque::swap()的O(1)交换对它不成立
+// 所以small_deque有自己的swap(): 双方都没有使用内嵌存储时仍然是O(1),
+// 否则逐个复制元素, 可能抛出异常
+// 使用前需要先包含<stl_deque.h>; 需要类模板的偏特化
+
+#ifndef __SGI_STL_INTERNAL_SMALL_DEQUE_H
+#define __SGI_STL_INTERNAL_SMALL_DEQUE_H
+
+__STL_BEGIN_NAMESPACE
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma set woff 1174
+#endif
+
+// 不能自定义缓冲区大小或者不支持偏特化的编译器上没有small_deque
+#if !defined(__STL_NON_TYPE_TMPL_PARAM_BUG) \
+    && defined(__STL_CLASS_PARTIAL_SPECIALIZATION)
+
+// 内嵌缓冲区按T对齐; 不知道如何指定对齐的编译器上只能按最严格的内建类型对齐
+#if __cplusplus >= 201103L
+#  define __STL_SMALL_DEQUE_ALIGN(T) alignas(T)
+#elif defined(__GNUC__)
+#  define __STL_SMALL_DEQUE_ALIGN(T) __attribute__((aligned(__alignof__(T))))
+#else
+#  define __STL_SMALL_DEQUE_ALIGN(T)
+#endif
+
+// 内嵌的存储, 作为small_deque的第一个基类, 保证在deque之前构造
+// 复制时不复制内容: 每个对象只使用自己的存储
+template <class T, size_t BufSiz>
+struct __small_deque_storage
+{
+  union node_storage {
+    __STL_SMALL_DEQUE_ALIGN(T) char buf[BufSiz * sizeof(T)];
+    long double ld;
+    double d;
+    long l;
+    void* p;
+  };
+
+  node_storage node_buf;
+  T* map_buf[8];                // 和deque::initial_map_size()一致
+  bool node_used;
+  bool map_used;
+
+  T* node() { return (T*) node_buf.buf; }
+  static size_t map_capacity() { return 8; }
+  bool in_use() const { return node_used || map_used; }
+
+  __small_deque_storage() : node_used(false), map_used(false) {}
+  __small_deque_storage(const __small_deque_storage&)
+    : node_used(false), map_used(false) {}
+  __small_deque_storage& operator=(const __small_deque_storage&)
+  {
+    return *this;
+  }
+};
+
+#undef __STL_SMALL_DEQUE_ALIGN
+
+// small_deque中的deque使用的分配器: 和Alloc完全相同, 只是类型不同,
+// 以便特化__deque_buffer_source
+template <class T, size_t N, class Alloc>
+struct __small_deque_alloc
+{
+  static void* allocate(size_t n) { return Alloc::allocate(n); }
+  static void deallocate(void* p, size_t n) { Alloc::deallocate(p, n); }
+  static void* reallocate(void* p, size_t old_sz, size_t new_sz)
+  {
+    return Alloc::reallocate(p, old_sz, new_sz);
+  }
+};
+
+template <class T, size_t N, class Alloc> class small_deque;
+
+// 按缓冲区读写small_deque, 见<stl_deque_io.h>
+template <class T, size_t N, class Alloc> struct __small_deque_io;
+
+// 内嵌的缓冲区和map空闲时优先使用, 释放时只清除标记
+// owner一定是某个small_deque中的deque, 由small_deque::storage_of()找到内嵌存储
+template <class T, size_t N, class Alloc>
+struct __deque_buffer_source<T, __small_deque_alloc<T, N, Alloc> >
+{
+  typedef Alloc plain_alloc;
+  typedef __small_deque_alloc<T, N, Alloc> alloc_type;
+  typedef deque<T, alloc_type, N> owner_type;
+  typedef __small_deque_storage<T, N> storage;
+
+  static storage* storage_of(owner_type* owner)
+  {
+    return small_deque<T, N, Alloc>::storage_of(owner);
+  }
+
+  static T* allocate_node(owner_type* owner, size_t n)
+  {
+    storage* s = storage_of(owner);
+    if (!s->node_used) {
+      s->node_used = true;
+      return s->node();
+    }
+    return simple_alloc<T, alloc_type>::allocate(n);
+  }
+
+  static void deallocate_node(owner_type* owner, T* p, size_t n)
+  {
+    storage* s = storage_of(owner);
+    if (p == s->node())
+      s->node_used = false;
+    else
+      simple_alloc<T, alloc_type>::deallocate(p, n);
+  }
+
+  static T** allocate_map(owner_type* owner, size_t n)
+  {
+    storage* s = storage_of(owner);
+    if (!s->map_used && n <= storage::map_capacity()) {
+      s->map_used = true;
+      return s->map_buf;
+    }
+    return simple_alloc<T*, alloc_type>::allocate(n);
+  }
+
+  static void deallocate_map(owner_type* owner, T** p, size_t n)
+  {
+    storage* s = storage_of(owner);
+    if (p == s->map_buf)
+      s->map_used = false;
+    else
+      simple_alloc<T*, alloc_type>::deallocate(p, n);
+  }
+};
+
+template <class T, size_t N, class Alloc = alloc>
+class small_deque : private __small_deque_storage<T, N>,
+                    private deque<T, __small_deque_alloc<T, N, Alloc>, N>
+{
+  typedef __small_deque_storage<T, N> storage;
+  typedef deque<T, __small_deque_alloc<T, N, Alloc>, N> base;
+
+  friend struct __deque_buffer_source<T, __small_deque_alloc<T, N, Alloc> >;
+  friend struct __small_deque_io<T, N, Alloc>;
+
+  // 从deque子对象找到同一个small_deque中的内嵌存储
+  // deque的构造函数中就会用到, 这时storage已经构造好了
+  static storage* storage_of(base* d) { return static_cast<small_deque*>(d); }
+
+public:
+  typedef typename base::value_type value_type;
+  typedef typename base::pointer pointer;
+  typedef typename base::const_pointer const_pointer;
+  typedef typename base::reference reference;
+  typedef typename base::const_reference const_reference;
+  typedef typename base::size_type size_type;
+  typedef typename base::difference_type difference_type;
+  typedef typename base::iterator iterator;
+  typedef typename base::const_iterator const_iterator;
+  typedef typename base::reverse_iterator reverse_iterator;
+  typedef typename base::const_reverse_iterator const_reverse_iterator;
+
+  // 内嵌缓冲区能放下的元素个数
+  static size_type inline_capacity() { return N - 1; }
+
+  // deque的公有接口; insert()和prepend()在下面逐个转发,
+  // 以免把deque中同名的受保护重载也变成公有的
+  using base::begin;
+  using base::end;
+  using base::rbegin;
+  using base::rend;
+  using base::operator[];
+  using base::front;
+  using base::back;
+  using base::size;
+  using base::max_size;
+  using base::empty;
+  using base::push_back;
+  using base::push_front;
+  using base::pop_back;
+  using base::pop_front;
+  using base::pop_front_n;
+  using base::consume_front;
+  using base::resize;
+  using base::append;
+  using base::append_n;
+  using base::prepend_n;
+  using base::reserve_back;
+  using base::reserve_front;
+  using base::shrink_to_fit;
+  using base::serialize;
+  using base::erase;
+  using base::clear;
+
+public:
+  small_deque() : storage(), base() {}
+
+  small_deque(size_type n, const value_type& value) : storage(), base()
+  {
+    insert(end(), n, value);
+  }
+
+  explicit small_deque(size_type n) : storage(), base()
+  {
+    insert(end(), n, value_type());
+  }
+
+  // base的析构函数负责清理已经插入的元素
+  small_deque(const small_deque& x) : storage(), base()
+  {
+    insert(end(), x.begin(), x.end());
+  }
+
+#ifdef __STL_MEMBER_TEMPLATES
+
+  template <class InputIterator>
+  small_deque(InputIterator first, InputIterator last) : storage(), base()
+  {
+    insert(end(), first, last);
+  }
+
+#else /* __STL_MEMBER_TEMPLATES */
+
+  small_deque(const value_type* first, const value_type* last)
+    : storage(), base()
+  {
+    insert(end(), first, last);
+  }
+
+  small_deque(const_iterator first, const_iterator last) : storage(), base()
+  {
+    insert(end(), first, last);
+  }
+
+#endif /* __STL_MEMBER_TEMPLATES */
+
+  small_deque& operator=(const small_deque& x)
+  {
+    base::operator=(x);
+    return *this;
+  }
+
+  // 只有双方都没有使用内嵌存储时才能交换指针
+  void swap(small_deque& x)
+  {
+    if (!storage::in_use() && !x.storage::in_use()) {
+      base::swap(x);
+      return;
+    }
+    small_deque tmp(x);
+    x = *this;
+    *this = tmp;
+  }
+
+public:                         // Insert
+  iterator insert(iterator pos, const value_type& x)
+  {
+    return base::insert(pos, x);
+  }
+  iterator insert(iterator pos) { return base::insert(pos); }
+  void insert(iterator pos, size_type n, const value_type& x)
+  {
+    base::insert(pos, n, x);
+  }
+  void insert(iterator pos, int n, const value_type& x)
+  {
+    base::insert(pos, (size_type) n, x);
+  }
+  void insert(iterator pos, long n, const value_type& x)
+  {
+    base::insert(pos, (size_type) n, x);
+  }
+
+#ifdef __STL_MEMBER_TEMPLATES
+
+  template <class InputIterator>
+  void insert(iterator pos, InputIterator first, InputIterator last)
+  {
+    base::insert(pos, first, last);
+  }
+
+  template <class InputIterator>
+  void prepend(InputIterator first, InputIterator last)
+  {
+    base::prepend(first, last);
+  }
+
+#else /* __STL_MEMBER_TEMPLATES */
+
+  void insert(iterator pos, const value_type* first, const value_type* last)
+  {
+    base::insert(pos, first, last);
+  }
+  void insert(iterator pos, const_iterator first, const_iterator last)
+  {
+    base::insert(pos, first, last);
+  }
+  void prepend(const value_type* first, const value_type* last)
+  {
+    base::prepend(first, last);
+  }
+  void prepend(const_iterator first, const_iterator last)
+  {
+    base::prepend(first, last);
+  }
+
+#endif /* __STL_MEMBER_TEMPLATES */
+
+public:
+  // deque::memory_stats()再加上内嵌存储的字节数
+  deque_memory_stats memory_stats() const
+  {
+    deque_memory_stats s = base::memory_stats();
+    if (storage::map_used)
+      s.inline_bytes += s.map_bytes;
+    if (storage::node_used)
+      s.inline_bytes += s.buffer_bytes;
+    return s;
+  }
+
+  // 和deque::deserialize()一样只适用于POD类型
+  // 内嵌存储不能随swap()交给临时对象, 所以原地复制:
+  // 先预留好缓冲区(失败时内容不变), 之后的复制和插入不再分配内存
+  void deserialize(const void* buf, size_type n)
+  {
+    const value_type* first = (const value_type*) buf;
+    size_type len = size();
+    if (n > len)
+      reserve_back(n - len);
+    if (len >= n) {
+      copy(first, first + n, begin());
+      erase(begin() + difference_type(n), end());
+    }
+    else {
+      copy(first, first + len, begin());
+      insert(end(), first + len, first + n);
+    }
+  }
+};
+
+// 比较经过deque迭代器的equal()/lexicographical_compare()
+template <class T, size_t N, class Alloc>
+inline bool operator==(const small_deque<T, N, Alloc>& x,
+                       const small_deque<T, N, Alloc>& y)
+{
+  return x.size() == y.size() && equal(x.begin(), x.end(), y.begin());
+}
+
+template <class T, size_t N, class Alloc>
+inline bool operator<(const small_deque<T, N, Alloc>& x,
+                      const small_deque<T, N, Alloc>& y)
+{
+  return lexicographical_compare(x.begin(), x.end(), y.begin(), y.end());
+}
+
+#ifdef __STL_FUNCTION_TMPL_PARTIAL_ORDER
+
+template <class T, size_t N, class Alloc>
+inline void swap(small_deque<T, N, Alloc>& x, small_deque<T, N, Alloc>& y)
+{
+  x.swap(y);
+}
+
+#endif /* __STL_FUNCTION_TMPL_PARTIAL_ORDER */
+
+#endif /* !__STL_NON_TYPE_TMPL_PARAM_BUG && __STL_CLASS_PARTIAL_SPECIALIZATION */
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma reset woff 1174
+#endif
+
+__STL_END_NAMESPACE
+
+#endif /* __SGI_STL_INTERNAL_SMALL_DEQUE_H */
+
+// Local Variables:
+// mode:C++
+// End:
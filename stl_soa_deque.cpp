@@ -0,0 +1,601 @@
+// Filename:    stl_soa_deque.h
+// 按列存放的deque(structure of arrays), 最多4列
+//
+// deque<Record>的每个缓冲区中存放的是整条记录, 只扫描其中一个字段时,
+// 其余字段也一起被读进cache
+// soa_deque<T0, T1, T2, T3>把每一列分开存放:
+//   map和start/finish只有一份, 所有列共用, 和deque一样管理缓冲区;
+//   每个缓冲区存放__soa_rows行, 内部按列划分: 先是__soa_rows个T0,
+//   然后是__soa_rows个T1, 依此类推, 每一列相对缓冲区起点按64字节对齐
+//   push/pop一行时各列同时进退, 一次分配就得到所有列的缓冲区
+// 每一列有自己的随机存取迭代器, 用法:
+//   soa_deque<long, int, double, int> d;
+//   d.push_back(ts, id, price, qty);
+//   double sum = accumulate(d.column_begin<2>(), d.column_end<2>(), 0.0);
+// 逐个缓冲区处理一列时用for_each_segment<K>(f), 每段调用f(first, last),
+// [first, last)是普通的连续数组, 内层循环可以被编译器向量化
+//
+// 不足4列时后面的类型用默认的__soa_none, 不占用空间
+// 需要编译器支持成员模板
+
+#ifndef __SGI_STL_INTERNAL_SOA_DEQUE_H
+#define __SGI_STL_INTERNAL_SOA_DEQUE_H
+
+__STL_BEGIN_NAMESPACE
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma set woff 1174
+#endif
+
+#ifdef __STL_MEMBER_TEMPLATES
+
+// 每个缓冲区的行数, 是2的幂也是64的倍数, 这样每列的起点都按64字节对齐
+enum { __soa_rows = 256 };
+enum { __soa_shift = 8 };
+
+// 不存在的列
+struct __soa_none {};
+
+template <class T>
+struct __soa_width { enum { value = sizeof(T) }; };
+
+__STL_TEMPLATE_NULL struct __soa_width<__soa_none> { enum { value = 0 }; };
+
+// 第K列的类型和它在缓冲区中的偏移
+template <int K> struct __soa_select;
+
+__STL_TEMPLATE_NULL struct __soa_select<0> {
+  template <class A, class B, class C, class D> struct rebind {
+    typedef A type;
+    enum { offset = 0 };
+  };
+};
+
+__STL_TEMPLATE_NULL struct __soa_select<1> {
+  template <class A, class B, class C, class D> struct rebind {
+    typedef B type;
+    enum { offset = __soa_rows * __soa_width<A>::value };
+  };
+};
+
+__STL_TEMPLATE_NULL struct __soa_select<2> {
+  template <class A, class B, class C, class D> struct rebind {
+    typedef C type;
+    enum { offset = __soa_rows * (__soa_width<A>::value + __soa_width<B>::value) };
+  };
+};
+
+__STL_TEMPLATE_NULL struct __soa_select<3> {
+  template <class A, class B, class C, class D> struct rebind {
+    typedef D type;
+    enum { offset = __soa_rows * (__soa_width<A>::value + __soa_width<B>::value
+                                  + __soa_width<C>::value) };
+  };
+};
+
+// 一列的迭代器, 和__deque_iterator相同, 只是缓冲区的起点要加上列的偏移Off
+template <class T, class Ref, class Ptr, size_t Off>
+struct __soa_column_iterator {
+  typedef __soa_column_iterator<T, T&, T*, Off>             iterator;
+  typedef __soa_column_iterator<T, const T&, const T*, Off> const_iterator;
+
+  typedef random_access_iterator_tag iterator_category;
+  typedef T value_type;
+  typedef Ptr pointer;
+  typedef Ref reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+  typedef char** map_pointer;
+
+  typedef __soa_column_iterator self;
+
+  T* cur;
+  T* first;
+  T* last;
+  map_pointer node;
+
+  static T* column(map_pointer y) { return (T*) (*y + Off); }
+
+  __soa_column_iterator(size_t row, map_pointer y)
+    : cur(column(y) + row), first(column(y)), last(first + __soa_rows), node(y) {}
+  __soa_column_iterator() : cur(0), first(0), last(0), node(0) {}
+  __soa_column_iterator(const iterator& x)
+    : cur(x.cur), first(x.first), last(x.last), node(x.node) {}
+
+  reference operator*() const { return *cur; }
+
+#ifndef __SGI_STL_NO_ARROW_OPERATOR
+  pointer operator->() const { return &(operator*()); }
+#endif /* __SGI_STL_NO_ARROW_OPERATOR */
+
+  difference_type operator-(const self& x) const
+  {
+    return difference_type(__soa_rows) * (node - x.node - 1) +
+      (cur - first) + (x.last - x.cur);
+  }
+
+  self& operator++()
+  {
+    if (++cur == last) {
+      set_node(node + 1);
+      cur = first;
+    }
+    return *this;
+  }
+
+  self operator++(int) { self tmp = *this; ++*this; return tmp; }
+
+  self& operator--()
+  {
+    if (cur == first) {
+      set_node(node - 1);
+      cur = last;
+    }
+    --cur;
+    return *this;
+  }
+
+  self operator--(int) { self tmp = *this; --*this; return tmp; }
+
+  // 行数是2的幂, 用移位和掩码求结点偏移和缓冲区内偏移
+  self& operator+=(difference_type n)
+  {
+    difference_type offset = n + (cur - first);
+    if (size_t(offset) < size_t(__soa_rows))
+      cur += n;
+    else {
+      difference_type node_offset =
+        offset > 0 ? difference_type(size_t(offset) >> __soa_shift)
+                   : -difference_type(size_t(-offset - 1) >> __soa_shift) - 1;
+      set_node(node + node_offset);
+      cur = first + difference_type(size_t(offset) & size_t(__soa_rows - 1));
+    }
+    return *this;
+  }
+
+  self operator+(difference_type n) const { self tmp = *this; return tmp += n; }
+  self& operator-=(difference_type n) { return *this += -n; }
+  self operator-(difference_type n) const { self tmp = *this; return tmp -= n; }
+
+  reference operator[](difference_type n) const { return *(*this + n); }
+
+  bool operator==(const self& x) const { return cur == x.cur; }
+  bool operator!=(const self& x) const { return !(*this == x); }
+  bool operator<(const self& x) const {
+    return (node == x.node) ? (cur < x.cur) : (node < x.node);
+  }
+
+  void set_node(map_pointer new_node)
+  {
+    node = new_node;
+    first = column(new_node);
+    last = first + difference_type(__soa_rows);
+  }
+};
+
+#ifndef __STL_CLASS_PARTIAL_SPECIALIZATION
+
+template <class T, class Ref, class Ptr, size_t Off>
+inline random_access_iterator_tag
+iterator_category(const __soa_column_iterator<T, Ref, Ptr, Off>&) {
+  return random_access_iterator_tag();
+}
+
+template <class T, class Ref, class Ptr, size_t Off>
+inline T* value_type(const __soa_column_iterator<T, Ref, Ptr, Off>&) {
+  return 0;
+}
+
+template <class T, class Ref, class Ptr, size_t Off>
+inline ptrdiff_t* distance_type(const __soa_column_iterator<T, Ref, Ptr, Off>&) {
+  return 0;
+}
+
+#endif /* __STL_CLASS_PARTIAL_SPECIALIZATION */
+
+template <class T0, class T1, class T2 = __soa_none, class T3 = __soa_none,
+          class Alloc = alloc>
+class soa_deque
+{
+public:
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  // 第K列的类型和迭代器
+  template <int K> struct column {
+    typedef typename __soa_select<K>::template rebind<T0, T1, T2, T3> field;
+    typedef typename field::type value_type;
+    typedef __soa_column_iterator<value_type, value_type&, value_type*,
+                                  field::offset> iterator;
+    typedef __soa_column_iterator<value_type, const value_type&,
+                                  const value_type*, field::offset>
+            const_iterator;
+  };
+
+protected:
+  typedef char** map_pointer;
+  typedef simple_alloc<char, Alloc> data_allocator;
+  typedef simple_alloc<char*, Alloc> map_allocator;
+
+  // 一行在map中的位置; finish所在的缓冲区总是已经分配
+  struct position {
+    map_pointer node;
+    size_type row;
+  };
+
+  enum { node_bytes = __soa_rows * (__soa_width<T0>::value
+                                    + __soa_width<T1>::value
+                                    + __soa_width<T2>::value
+                                    + __soa_width<T3>::value) };
+
+  position start;
+  position finish;
+  map_pointer map;
+  size_type map_size;
+
+  static T0* col0(char* p) { return (T0*) p; }
+  static T1* col1(char* p)
+  {
+    return (T1*) (p + __soa_select<1>::template rebind<T0, T1, T2, T3>::offset);
+  }
+  static T2* col2(char* p)
+  {
+    return (T2*) (p + __soa_select<2>::template rebind<T0, T1, T2, T3>::offset);
+  }
+  static T3* col3(char* p)
+  {
+    return (T3*) (p + __soa_select<3>::template rebind<T0, T1, T2, T3>::offset);
+  }
+
+public:
+  template <int K>
+  typename column<K>::iterator column_begin()
+  {
+    return typename column<K>::iterator(start.row, start.node);
+  }
+
+  template <int K>
+  typename column<K>::iterator column_end()
+  {
+    return typename column<K>::iterator(finish.row, finish.node);
+  }
+
+  template <int K>
+  typename column<K>::const_iterator column_begin() const
+  {
+    return typename column<K>::const_iterator(start.row, start.node);
+  }
+
+  template <int K>
+  typename column<K>::const_iterator column_end() const
+  {
+    return typename column<K>::const_iterator(finish.row, finish.node);
+  }
+
+  // 第i行的第K列
+  template <int K>
+  typename column<K>::value_type& get(size_type i)
+  {
+    return column_begin<K>()[difference_type(i)];
+  }
+
+  template <int K>
+  const typename column<K>::value_type& get(size_type i) const
+  {
+    return column_begin<K>()[difference_type(i)];
+  }
+
+  // 对第K列的每段连续元素调用f(first, last), 按从前到后的顺序
+  template <int K, class Function>
+  Function for_each_segment(Function f)
+  {
+    typedef typename column<K>::value_type value_type;
+    typedef typename column<K>::iterator iter;
+    for (map_pointer n = start.node; n <= finish.node; ++n) {
+      value_type* first = iter::column(n);
+      f(first + (n == start.node ? start.row : 0),
+        first + (n == finish.node ? finish.row : size_type(__soa_rows)));
+    }
+    return f;
+  }
+
+  template <int K, class Function>
+  Function for_each_segment(Function f) const
+  {
+    typedef typename column<K>::value_type value_type;
+    typedef typename column<K>::const_iterator iter;
+    for (map_pointer n = start.node; n <= finish.node; ++n) {
+      const value_type* first = iter::column(n);
+      f(first + (n == start.node ? start.row : 0),
+        first + (n == finish.node ? finish.row : size_type(__soa_rows)));
+    }
+    return f;
+  }
+
+  size_type size() const
+  {
+    return size_type(finish.node - start.node) * __soa_rows
+      + finish.row - start.row;
+  }
+  size_type max_size() const { return size_type(-1); }
+  bool empty() const
+  {
+    return start.node == finish.node && start.row == finish.row;
+  }
+
+public:
+  soa_deque() : map(0), map_size(0)
+  {
+    create_map_and_nodes();
+  }
+
+  soa_deque(const soa_deque& x) : map(0), map_size(0)
+  {
+    create_map_and_nodes();
+    __STL_TRY {
+      append(x);
+    }
+    __STL_UNWIND(clear(); destroy_map_and_nodes());
+  }
+
+  ~soa_deque()
+  {
+    clear();
+    destroy_map_and_nodes();
+  }
+
+  soa_deque& operator=(const soa_deque& x)
+  {
+    if (&x != this) {
+      soa_deque tmp(x);
+      swap(tmp);
+    }
+    return *this;
+  }
+
+  void swap(soa_deque& x)
+  {
+    __STD::swap(start, x.start);
+    __STD::swap(finish, x.finish);
+    __STD::swap(map, x.map);
+    __STD::swap(map_size, x.map_size);
+  }
+
+public:
+  void push_back(const T0& a, const T1& b,
+                 const T2& c = T2(), const T3& d = T3())
+  {
+    if (finish.row != __soa_rows - 1) {
+      construct_row(*finish.node, finish.row, a, b, c, d);
+      ++finish.row;
+    }
+    else
+      push_back_aux(a, b, c, d);
+  }
+
+  void push_front(const T0& a, const T1& b,
+                  const T2& c = T2(), const T3& d = T3())
+  {
+    if (start.row != 0) {
+      construct_row(*start.node, start.row - 1, a, b, c, d);
+      --start.row;
+    }
+    else
+      push_front_aux(a, b, c, d);
+  }
+
+  void pop_back()
+  {
+    if (finish.row == 0) {
+      data_allocator::deallocate(*finish.node, node_bytes);
+      --finish.node;
+      finish.row = __soa_rows;
+    }
+    --finish.row;
+    destroy_row(*finish.node, finish.row);
+  }
+
+  void pop_front()
+  {
+    destroy_row(*start.node, start.row);
+    if (++start.row == __soa_rows) {
+      data_allocator::deallocate(*start.node, node_bytes);
+      ++start.node;
+      start.row = 0;
+    }
+  }
+
+  // 保留start所在的缓冲区
+  void clear()
+  {
+    for (map_pointer n = start.node; n <= finish.node; ++n) {
+      size_type first = n == start.node ? start.row : 0;
+      size_type last = n == finish.node ? finish.row : size_type(__soa_rows);
+      destroy_rows(*n, first, last);
+      if (n != start.node)
+        data_allocator::deallocate(*n, node_bytes);
+    }
+    start.row = 0;
+    finish = start;
+  }
+
+protected:
+  // 有些列不存在(宽度为0)时, 它们的地址和下一列重合, 不能构造或析构
+  static void construct_row(char* p, size_type i, const T0& a, const T1& b,
+                            const T2& c, const T3& d)
+  {
+    construct(col0(p) + i, a);
+    __STL_TRY {
+      construct(col1(p) + i, b);
+      __STL_TRY {
+        if (__soa_width<T2>::value)
+          construct(col2(p) + i, c);
+        __STL_TRY {
+          if (__soa_width<T3>::value)
+            construct(col3(p) + i, d);
+        }
+        __STL_UNWIND(if (__soa_width<T2>::value) destroy(col2(p) + i));
+      }
+      __STL_UNWIND(destroy(col1(p) + i));
+    }
+    __STL_UNWIND(destroy(col0(p) + i));
+  }
+
+  static void destroy_row(char* p, size_type i)
+  {
+    destroy_rows(p, i, i + 1);
+  }
+
+  static void destroy_rows(char* p, size_type first, size_type last)
+  {
+    destroy(col0(p) + first, col0(p) + last);
+    destroy(col1(p) + first, col1(p) + last);
+    if (__soa_width<T2>::value)
+      destroy(col2(p) + first, col2(p) + last);
+    if (__soa_width<T3>::value)
+      destroy(col3(p) + first, col3(p) + last);
+  }
+
+  void append(const soa_deque& x)
+  {
+    for (map_pointer n = x.start.node; n <= x.finish.node; ++n) {
+      size_type first = n == x.start.node ? x.start.row : 0;
+      size_type last = n == x.finish.node ? x.finish.row : size_type(__soa_rows);
+      char* p = *n;
+      for (size_type i = first; i < last; ++i)
+        push_back(col0(p)[i], col1(p)[i],
+                  __soa_width<T2>::value ? col2(p)[i] : T2(),
+                  __soa_width<T3>::value ? col3(p)[i] : T3());
+    }
+  }
+
+  void push_back_aux(const T0& a, const T1& b, const T2& c, const T3& d);
+  void push_front_aux(const T0& a, const T1& b, const T2& c, const T3& d);
+
+  void create_map_and_nodes();
+  void destroy_map_and_nodes();
+  void reallocate_map(size_type nodes_to_add, bool add_at_front);
+
+  void reserve_map_at_back()
+  {
+    if (2 > map_size - (finish.node - map))
+      reallocate_map(1, false);
+  }
+
+  void reserve_map_at_front()
+  {
+    if (1 > size_type(start.node - map))
+      reallocate_map(1, true);
+  }
+};
+
+// 最后一个位置用掉之后finish要移到新的缓冲区, 所以先分配再构造
+template <class T0, class T1, class T2, class T3, class Alloc>
+void soa_deque<T0, T1, T2, T3, Alloc>::push_back_aux(const T0& a,
+                                                     const T1& b,
+                                                     const T2& c,
+                                                     const T3& d)
+{
+  reserve_map_at_back();
+  *(finish.node + 1) = data_allocator::allocate(node_bytes);
+  __STL_TRY {
+    construct_row(*finish.node, finish.row, a, b, c, d);
+    ++finish.node;
+    finish.row = 0;
+  }
+  __STL_UNWIND(data_allocator::deallocate(*(finish.node + 1), node_bytes));
+}
+
+template <class T0, class T1, class T2, class T3, class Alloc>
+void soa_deque<T0, T1, T2, T3, Alloc>::push_front_aux(const T0& a,
+                                                      const T1& b,
+                                                      const T2& c,
+                                                      const T3& d)
+{
+  reserve_map_at_front();
+  *(start.node - 1) = data_allocator::allocate(node_bytes);
+  __STL_TRY {
+    construct_row(*(start.node - 1), __soa_rows - 1, a, b, c, d);
+    --start.node;
+    start.row = __soa_rows - 1;
+  }
+  __STL_UNWIND(data_allocator::deallocate(*(start.node - 1), node_bytes));
+}
+
+// 和deque一样, map至少8个结点, 起始缓冲区放在中间
+template <class T0, class T1, class T2, class T3, class Alloc>
+void soa_deque<T0, T1, T2, T3, Alloc>::create_map_and_nodes()
+{
+  map_size = 8;
+  map = map_allocator::allocate(map_size);
+  __STL_TRY {
+    start.node = finish.node = map + map_size / 2;
+    *start.node = data_allocator::allocate(node_bytes);
+  }
+  __STL_UNWIND(map_allocator::deallocate(map, map_size));
+  start.row = finish.row = 0;
+}
+
+template <class T0, class T1, class T2, class T3, class Alloc>
+void soa_deque<T0, T1, T2, T3, Alloc>::destroy_map_and_nodes()
+{
+  for (map_pointer n = start.node; n <= finish.node; ++n)
+    data_allocator::deallocate(*n, node_bytes);
+  map_allocator::deallocate(map, map_size);
+}
+
+template <class T0, class T1, class T2, class T3, class Alloc>
+void soa_deque<T0, T1, T2, T3, Alloc>::reallocate_map(size_type nodes_to_add,
+                                                      bool add_at_front)
+{
+  size_type old_num_nodes = finish.node - start.node + 1;
+  size_type new_num_nodes = old_num_nodes + nodes_to_add;
+
+  map_pointer new_nstart;
+  if (map_size > 2 * new_num_nodes) {
+    new_nstart = map + (map_size - new_num_nodes) / 2
+                     + (add_at_front ? nodes_to_add : 0);
+    if (new_nstart < start.node)
+      copy(start.node, finish.node + 1, new_nstart);
+    else
+      copy_backward(start.node, finish.node + 1, new_nstart + old_num_nodes);
+  }
+  else {
+    size_type new_map_size = map_size + max(map_size, nodes_to_add) + 2;
+    map_pointer new_map = map_allocator::allocate(new_map_size);
+    new_nstart = new_map + (new_map_size - new_num_nodes) / 2
+                         + (add_at_front ? nodes_to_add : 0);
+    copy(start.node, finish.node + 1, new_nstart);
+    map_allocator::deallocate(map, map_size);
+    map = new_map;
+    map_size = new_map_size;
+  }
+
+  finish.node = new_nstart + (finish.node - start.node);
+  start.node = new_nstart;
+}
+
+#ifdef __STL_FUNCTION_TMPL_PARTIAL_ORDER
+
+template <class T0, class T1, class T2, class T3, class Alloc>
+inline void swap(soa_deque<T0, T1, T2, T3, Alloc>& x,
+                 soa_deque<T0, T1, T2, T3, Alloc>& y)
+{
+  x.swap(y);
+}
+
+#endif /* __STL_FUNCTION_TMPL_PARTIAL_ORDER */
+
+#endif /* __STL_MEMBER_TEMPLATES */
+
+#if defined(__sgi) && !defined(__GNUC__) && (_MIPS_SIM != _MIPS_SIM_ABI32)
+#pragma reset woff 1174
+#endif
+
+__STL_END_NAMESPACE
+
+#endif /* __SGI_STL_INTERNAL_SOA_DEQUE_H */
+
+// Local Variables:
+// mode:C++
+// End: